@@ -0,0 +1,417 @@
+#include "nn/Network.hpp"
+#include "nn/SparseNetwork.hpp"
+#include "nn/ActivationFunction.hpp"
+#include "nn/CostFunction.hpp"
+#include "nn/Synthetic.hpp"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+/*
+	Micro-benchmarks for the nn core. Every benchmark is run `warmup` times
+	without being measured and then `repetitions` times, and the distribution
+	of the repetition times is printed as CSV (default) or JSON lines.
+
+	Usage: nn_bench [--topology 784,100,10]... [--batch 10,50] [--samples 2000]
+	                [--dataset blobs|digits|autoencoder] [--warmup 2]
+	                [--repetitions 10] [--format csv|json]
+	                [--filter substring] [--seed 42]
+*/
+
+using nn::flt_t;
+using nn::Sample;
+
+namespace {
+
+struct Options {
+	std::vector<std::vector<size_t>> topologies;
+	std::vector<size_t> batchSizes{10};
+	size_t samples = 2000;
+	size_t warmup = 2;
+	size_t repetitions = 10;
+	std::string dataset = "blobs";
+	std::string format = "csv";
+	std::string filter = "";
+	unsigned int seed = 42;
+};
+
+struct Result {
+	std::string name;
+	std::string topology;
+	size_t batchSize;
+	size_t items; // processed per repetition, e.g. samples or values
+	std::vector<double> seconds;
+};
+
+std::vector<size_t> parseList(const std::string& list) {
+	std::vector<size_t> result;
+	std::stringstream stream{list};
+	std::string item;
+	while(std::getline(stream, item, ',')) {
+		result.push_back(std::stoul(item));
+	}
+	return result;
+}
+
+Options parseOptions(int argc, char const* argv[]) {
+	Options options;
+	for(int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (i + 1 == argc)
+			throw std::runtime_error{"Missing value for argument " + arg};
+		std::string value = argv[++i];
+
+		if (arg == "--topology") options.topologies.push_back(parseList(value));
+		else if (arg == "--batch") options.batchSizes = parseList(value);
+		else if (arg == "--samples") options.samples = std::stoul(value);
+		else if (arg == "--warmup") options.warmup = std::stoul(value);
+		else if (arg == "--repetitions") options.repetitions = std::max(1ul, std::stoul(value));
+		else if (arg == "--dataset") options.dataset = value;
+		else if (arg == "--format") options.format = value;
+		else if (arg == "--filter") options.filter = value;
+		else if (arg == "--seed") options.seed = std::stoul(value);
+		else throw std::runtime_error{"Unknown argument " + arg};
+	}
+
+	if (options.topologies.empty())
+		options.topologies.push_back({784, 100, 10});
+	return options;
+}
+
+std::string topologyName(const std::vector<size_t>& topology) {
+	std::string result;
+	for(auto&& dimension : topology)
+		result += (result.empty() ? "" : "-") + std::to_string(dimension);
+	return result;
+}
+
+std::vector<Sample> generateSamples(const Options& options, const std::vector<size_t>& topology) {
+	if (options.dataset == "digits") {
+		const size_t imageSize = std::lround(std::sqrt(topology.front()));
+		if (imageSize * imageSize != topology.front() || topology.back() != 10)
+			throw std::runtime_error{"The digits dataset needs a square number of inputs and 10 outputs"};
+		return nn::syntheticDigits(options.samples, options.seed, imageSize);
+	} else if (options.dataset == "autoencoder") {
+		if (topology.front() != topology.back())
+			throw std::runtime_error{"The autoencoder dataset needs as many outputs as inputs"};
+		return nn::autoencoderSet(options.samples, topology.front(), options.seed);
+	} else if (options.dataset == "blobs") {
+		return nn::gaussianBlobs(options.samples, topology.front(), topology.back(), options.seed);
+	}
+	throw std::runtime_error{"Unknown dataset " + options.dataset};
+}
+
+bool compare(const std::vector<flt_t>& expectedOutputs, const std::vector<flt_t>& actualOutputs) {
+	return std::max_element(expectedOutputs.begin(), expectedOutputs.end()) - expectedOutputs.begin()
+		== std::max_element(actualOutputs.begin(), actualOutputs.end()) - actualOutputs.begin();
+}
+
+// prevents the compiler from optimizing away the benchmarked computations
+volatile flt_t sink;
+
+class Runner {
+	const Options& m_options;
+	std::vector<Result> m_results;
+
+public:
+	Runner(const Options& options) : m_options{options}, m_results{} {}
+
+	template<class F>
+	void run(const std::string& name, const std::string& topology, const size_t batchSize, const size_t items, F&& f) {
+		if (name.find(m_options.filter) == std::string::npos)
+			return;
+
+		for(size_t w = 0; w != m_options.warmup; ++w)
+			f();
+
+		Result result{name, topology, batchSize, items, {}};
+		for(size_t r = 0; r != m_options.repetitions; ++r) {
+			auto start = std::chrono::steady_clock::now();
+			f();
+			auto end = std::chrono::steady_clock::now();
+			result.seconds.push_back(std::chrono::duration<double>(end - start).count());
+		}
+		m_results.push_back(std::move(result));
+	}
+
+	void print(std::ostream& out) const {
+		if (m_options.format == "csv")
+			out << "name,topology,batch_size,items,warmup,repetitions,min_s,mean_s,median_s,p99_s,items_per_s\n";
+
+		for(auto&& result : m_results) {
+			std::vector<double> sorted = result.seconds;
+			std::sort(sorted.begin(), sorted.end());
+			const double min = sorted.front();
+			const double mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+			const double median = sorted.size() % 2 == 1 ? sorted[sorted.size() / 2]
+				: (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]) / 2;
+			// nearest-rank percentile
+			const double p99 = sorted[std::min(sorted.size() - 1, (size_t)std::ceil(0.99 * sorted.size()) - 1)];
+			const double itemsPerSecond = result.items / median;
+
+			if (m_options.format == "json") {
+				out << "{\"name\":\"" << result.name << "\",\"topology\":\"" << result.topology
+					<< "\",\"batch_size\":" << result.batchSize << ",\"items\":" << result.items
+					<< ",\"warmup\":" << m_options.warmup << ",\"repetitions\":" << m_options.repetitions
+					<< ",\"min_s\":" << min << ",\"mean_s\":" << mean << ",\"median_s\":" << median
+					<< ",\"p99_s\":" << p99 << ",\"items_per_s\":" << itemsPerSecond << "}\n";
+			} else {
+				out << result.name << "," << result.topology << "," << result.batchSize << "," << result.items
+					<< "," << m_options.warmup << "," << m_options.repetitions << "," << min << "," << mean
+					<< "," << median << "," << p99 << "," << itemsPerSecond << "\n";
+			}
+		}
+	}
+};
+
+void benchmarkNetwork(Runner& runner, const Options& options, const std::vector<size_t>& topology) {
+	const std::string name = topologyName(topology);
+	nn::setRandomSeed(options.seed);
+	std::vector<Sample> samples = generateSamples(options, topology);
+	nn::Network net{topology, nn::sigmoid, nn::crossEntropyCost};
+
+	runner.run("feedforward", name, 1, samples.size(), [&]{
+		for(auto&& sample : samples)
+			net.feedforward(sample.getInputs());
+		sink = net.m_nodes.back().a[0];
+	});
+	runner.run("calculate", name, 1, samples.size(), [&]{
+		for(auto&& sample : samples)
+			sink = net.calculate(sample.getInputs())[0];
+	});
+	std::vector<flt_t> outputs(net.outputCount());
+	runner.run("calculate/buffer", name, 1, samples.size(), [&]{
+		for(auto&& sample : samples) {
+			net.calculate(sample.getInputs(), outputs.data());
+			sink = outputs[0];
+		}
+	});
+	// the same inputs scored in batches, as a server does with many requests
+	std::vector<flt_t> inputMatrix;
+	for(auto&& sample : samples)
+		inputMatrix.insert(inputMatrix.end(), sample.getInputs().begin(), sample.getInputs().end());
+	std::vector<flt_t> outputMatrix(samples.size() * net.outputCount());
+	const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+	for(const size_t batchSize : {64, 256, 1024}) {
+		runner.run("calculateBatch", name, batchSize, samples.size(), [&]{
+			for(size_t start = 0; start < samples.size(); start += batchSize)
+				net.calculateBatch(inputMatrix.data() + start * topology.front(), std::min(batchSize, samples.size() - start),
+					outputMatrix.data() + start * net.outputCount());
+			sink = outputMatrix[0];
+		});
+		if (threads > 1) {
+			runner.run("calculateBatch/threads", name, batchSize, samples.size(), [&]{
+				for(size_t start = 0; start < samples.size(); start += batchSize)
+					net.calculateBatch(inputMatrix.data() + start * topology.front(), std::min(batchSize, samples.size() - start),
+						outputMatrix.data() + start * net.outputCount(), threads);
+				sink = outputMatrix[0];
+			});
+		}
+	}
+	runner.run("backpropagation", name, 1, samples.size(), [&]{
+		for(auto&& sample : samples)
+			net.backpropagation(sample);
+		sink = net.m_nodes.back().error[0];
+	});
+
+	for(auto&& batchSize : options.batchSizes) {
+		runner.run("momentumSGDMiniBatch", name, batchSize, samples.size(), [&]{
+			for(size_t start = 0; start < samples.size(); start += batchSize) {
+				auto beg = samples.cbegin() + start;
+				auto end = samples.cbegin() + std::min(start + batchSize, samples.size());
+				net.momentumSGDMiniBatch(beg, end, 0.1, 1.0, 0.5);
+			}
+		});
+		// the epochs shuffle their samples in place with the engine of the library: shuffling a
+		// copy from the seed keeps the entries reproducible and the other benchmarks in order
+		std::vector<Sample> shuffled = samples;
+		nn::setRandomSeed(options.seed);
+		runner.run("momentumSGDEpoch", name, batchSize, samples.size(), [&]{
+			net.momentumSGDEpoch(shuffled, batchSize, 0.1, 1.0, 0.5);
+		});
+	}
+
+	runner.run("evaluate", name, 1, samples.size(), [&]{
+		sink = net.evaluate(samples, compare);
+	});
+	runner.run("cost", name, 1, samples.size(), [&]{
+		sink = net.cost(samples, 1.0);
+	});
+
+	size_t parameters = 0;
+	for(size_t x = 1; x != net.m_nodes.size(); ++x)
+		parameters += net.m_nodes[x].size() * (net.m_nodes[x-1].size() + 1);
+	std::string saved;
+	runner.run("save", name, 1, parameters, [&]{
+		std::stringstream stream;
+		stream << net;
+		saved = stream.str();
+	});
+	runner.run("load", name, 1, parameters, [&]{
+		std::stringstream stream{saved};
+		nn::Network loaded{nn::sigmoid, nn::crossEntropyCost};
+		stream >> loaded;
+		sink = loaded.m_layers.back()->biases()[0];
+	});
+
+	// inference after pruning 90% of the weights, dense and in CSR format
+	nn::Network pruned{nn::sigmoid, nn::crossEntropyCost};
+	{
+		std::stringstream stream;
+		stream << net;
+		stream >> pruned;
+	}
+	pruned.pruneByMagnitude(0.9);
+	nn::SparseNetwork sparse{pruned};
+	runner.run("calculate/pruned90", name, 1, samples.size(), [&]{
+		for(auto&& sample : samples)
+			sink = pruned.calculate(sample.getInputs())[0];
+	});
+	runner.run("sparseCalculate/pruned90", name, 1, samples.size(), [&]{
+		for(auto&& sample : samples)
+			sink = sparse.calculate(sample.getInputs())[0];
+	});
+}
+
+// a convolutional autoencoder of 32x32 RGB images, whose fully-connected
+// equivalent would have more than 25 million weights
+void benchmarkConvolutions(Runner& runner, const Options& options) {
+	nn::setRandomSeed(options.seed);
+	const nn::Conv2D encoder{{32, 32, 3}, 16, 4, 2, 1};
+	const nn::ConvTranspose2D decoder{encoder.outputShape(), 3, 4, 2, 1};
+	const std::vector<size_t> topology{encoder.inputShape().size(), encoder.outputShape().size(), decoder.outputShape().size()};
+	const std::string name = "conv-" + topologyName(topology);
+	std::vector<Sample> samples = nn::autoencoderSet(options.samples, topology.front(), options.seed);
+	nn::Network net{topology, {&nn::rectifiedLinear, &nn::sigmoid}, {&encoder, &decoder}, nn::crossEntropyCost};
+
+	runner.run("feedforward", name, 1, samples.size(), [&]{
+		for(auto&& sample : samples)
+			net.feedforward(sample.getInputs());
+		sink = net.m_nodes.back().a[0];
+	});
+	runner.run("calculateBatch", name, samples.size(), samples.size(), [&]{
+		sink = net.calculateBatch(samples)[0];
+	});
+	runner.run("backpropagation", name, 1, samples.size(), [&]{
+		for(auto&& sample : samples)
+			net.backpropagation(sample);
+		sink = net.m_nodes.back().error[0];
+	});
+	for(auto&& batchSize : options.batchSizes) {
+		// see the momentumSGDEpoch of benchmarkNetwork
+		std::vector<Sample> shuffled = samples;
+		nn::setRandomSeed(options.seed);
+		runner.run("momentumSGDEpoch", name, batchSize, samples.size(), [&]{
+			net.momentumSGDEpoch(shuffled, batchSize, 0.1, 1.0, 0.5);
+		});
+	}
+
+	// the time overhead of recomputing the im2col matrices in the backward pass
+	net.setRecomputation(true);
+	runner.run("backpropagation/recompute", name, 1, samples.size(), [&]{
+		for(auto&& sample : samples)
+			net.backpropagation(sample);
+		sink = net.m_nodes.back().error[0];
+	});
+	for(auto&& batchSize : options.batchSizes) {
+		std::vector<Sample> shuffled = samples;
+		nn::setRandomSeed(options.seed);
+		runner.run("momentumSGDEpoch/recompute", name, batchSize, samples.size(), [&]{
+			net.momentumSGDEpoch(shuffled, batchSize, 0.1, 1.0, 0.5);
+		});
+	}
+}
+
+void benchmarkFunctions(Runner& runner, const Options& options) {
+	constexpr size_t count = 1 << 20;
+	std::mt19937 engine{options.seed};
+	std::normal_distribution<flt_t> zDistribution{0.0, 2.0};
+	std::uniform_real_distribution<flt_t> aDistribution{0.001, 0.999};
+	std::vector<flt_t> z(count), a(count), y(count);
+	for(size_t i = 0; i != count; ++i) {
+		z[i] = zDistribution(engine);
+		a[i] = aDistribution(engine);
+		y[i] = aDistribution(engine) < 0.5 ? 0.0 : 1.0;
+	}
+
+	const std::pair<const char*, nn::ActivationFunction*> activationFunctions[] = {
+		{"sigmoid", &nn::sigmoid}, {"fastSigmoid", &nn::fastSigmoid}, {"tanh", &nn::tanh},
+		{"linear", &nn::linear}, {"rectifiedLinear", &nn::rectifiedLinear},
+		{"leakyRectifiedLinear", &nn::leakyRectifiedLinear}, {"hardSigmoid", &nn::hardSigmoid},
+		{"hardTanh", &nn::hardTanh},
+	};
+	std::vector<flt_t> result(count);
+	for(auto&& [functionName, f] : activationFunctions) {
+		runner.run(std::string{"activationLayer/"} + functionName, "", 1, count, [&, f = f]{
+			f->apply(z.data(), result.data(), count);
+			sink = result[count / 2];
+		});
+		runner.run(std::string{"activationDerivativeLayer/"} + functionName, "", 1, count, [&, f = f]{
+			f->derivatives(z.data(), result.data(), count);
+			sink = result[count / 2];
+		});
+		runner.run(std::string{"activation/"} + functionName, "", 1, count, [&, f = f]{
+			flt_t acc = 0;
+			for(auto&& value : z)
+				acc += (*f)(value);
+			sink = acc;
+		});
+		runner.run(std::string{"activationDerivative/"} + functionName, "", 1, count, [&, f = f]{
+			flt_t acc = 0;
+			for(auto&& value : z)
+				acc += f->derivative(value);
+			sink = acc;
+		});
+	}
+
+	const std::pair<const char*, nn::CostFunction*> costFunctions[] = {
+		{"quadratic", &nn::quadraticCost}, {"crossEntropy", &nn::crossEntropyCost},
+		{"categoricalCrossEntropy", &nn::categoricalCrossEntropyCost},
+	};
+	for(auto&& [functionName, f] : costFunctions) {
+		runner.run(std::string{"cost/"} + functionName, "", 1, count, [&, f = f]{
+			flt_t acc = 0;
+			for(size_t i = 0; i != count; ++i)
+				acc += (*f)(a[i], y[i]);
+			sink = acc;
+		});
+		runner.run(std::string{"costDerivative/"} + functionName, "", 1, count, [&, f = f]{
+			flt_t acc = 0;
+			for(size_t i = 0; i != count; ++i)
+				acc += f->derivative(z[i], a[i], y[i], nn::sigmoid);
+			sink = acc;
+		});
+	}
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+	Options options;
+	try {
+		options = parseOptions(argc, argv);
+	} catch(const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+
+	Runner runner{options};
+	try {
+		for(auto&& topology : options.topologies)
+			benchmarkNetwork(runner, options, topology);
+		benchmarkConvolutions(runner, options);
+	} catch(const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+	benchmarkFunctions(runner, options);
+	runner.print(std::cout);
+}
@@ -0,0 +1,166 @@
+#include "nn/Network.hpp"
+#include "nn/ActivationFunction.hpp"
+#include "nn/CostFunction.hpp"
+#include "nn/Synthetic.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+/*
+	Replaces a dense layer of a trained network with two thinner ones of a
+	lower rank (Network::factorizeLayer), and prints as CSV the parameters,
+	the test accuracy and cost, and the inference time of every rank, before
+	and after a short fine-tuning. The first row is the original network.
+
+	Usage: nn_lowrank [--model network.txt | --topology 784,256,10]
+	                  [--dataset blobs|digits|autoencoder] [--samples 4000]
+	                  [--epochs 3] [--layer 1] [--ranks 8,16,32,64]
+	                  [--fine-tune 1] [--seed 42]
+
+	Without --model, a network with the given topology is first trained for
+	--epochs epochs. The test samples are generated with the next seed.
+*/
+
+using nn::flt_t;
+using nn::Sample;
+
+namespace {
+
+struct Options {
+	std::string model = "";
+	std::vector<size_t> topology{784, 256, 10};
+	std::string dataset = "digits";
+	size_t samples = 4000;
+	size_t epochs = 3;
+	size_t layer = 1;
+	std::vector<size_t> ranks{8, 16, 32, 64};
+	size_t fineTuneEpochs = 1;
+	unsigned int seed = 42;
+};
+
+std::vector<size_t> parseList(const std::string& list) {
+	std::vector<size_t> result;
+	std::stringstream stream{list};
+	std::string item;
+	while(std::getline(stream, item, ',')) {
+		result.push_back(std::stoul(item));
+	}
+	return result;
+}
+
+Options parseOptions(int argc, char const* argv[]) {
+	Options options;
+	for(int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (i + 1 == argc)
+			throw std::runtime_error{"Missing value for argument " + arg};
+		std::string value = argv[++i];
+
+		if (arg == "--model") options.model = value;
+		else if (arg == "--topology") options.topology = parseList(value);
+		else if (arg == "--dataset") options.dataset = value;
+		else if (arg == "--samples") options.samples = std::stoul(value);
+		else if (arg == "--epochs") options.epochs = std::stoul(value);
+		else if (arg == "--layer") options.layer = std::stoul(value);
+		else if (arg == "--ranks") options.ranks = parseList(value);
+		else if (arg == "--fine-tune") options.fineTuneEpochs = std::stoul(value);
+		else if (arg == "--seed") options.seed = std::stoul(value);
+		else throw std::runtime_error{"Unknown argument " + arg};
+	}
+	return options;
+}
+
+std::vector<Sample> generateSamples(const Options& options, const std::vector<size_t>& topology, const unsigned int seed) {
+	if (options.dataset == "digits") {
+		const size_t imageSize = std::lround(std::sqrt(topology.front()));
+		if (imageSize * imageSize != topology.front() || topology.back() != 10)
+			throw std::runtime_error{"The digits dataset needs a square number of inputs and 10 outputs"};
+		return nn::syntheticDigits(options.samples, seed, imageSize);
+	} else if (options.dataset == "autoencoder") {
+		if (topology.front() != topology.back())
+			throw std::runtime_error{"The autoencoder dataset needs as many outputs as inputs"};
+		return nn::autoencoderSet(options.samples, topology.front(), seed);
+	} else if (options.dataset == "blobs") {
+		return nn::gaussianBlobs(options.samples, topology.front(), topology.back(), seed);
+	}
+	throw std::runtime_error{"Unknown dataset " + options.dataset};
+}
+
+bool compare(const std::vector<flt_t>& expectedOutputs, const std::vector<flt_t>& actualOutputs) {
+	return std::max_element(expectedOutputs.begin(), expectedOutputs.end()) - expectedOutputs.begin()
+		== std::max_element(actualOutputs.begin(), actualOutputs.end()) - actualOutputs.begin();
+}
+
+size_t parameterCount(const nn::Network& net) {
+	size_t parameters = 0;
+	for(size_t x = 1; x != net.m_nodes.size(); ++x)
+		parameters += net.m_nodes[x].size() * (net.m_nodes[x-1].size() + 1);
+	return parameters;
+}
+
+// prevents the compiler from optimizing away the measured computations
+volatile flt_t sink;
+
+void printRow(const std::string& rank, nn::Network& net, std::vector<Sample>& trainSamples,
+		const std::vector<Sample>& testSamples, const Options& options) {
+	std::cout << rank << "," << parameterCount(net) << ",";
+
+	auto start = std::chrono::steady_clock::now();
+	for(auto&& sample : testSamples)
+		sink = net.calculate(sample.getInputs())[0];
+	auto end = std::chrono::steady_clock::now();
+	std::cout << std::chrono::duration<double>(end - start).count() / testSamples.size() * 1e6 << ",";
+
+	std::cout << (double)net.evaluate(testSamples, compare) / testSamples.size() << "," << net.cost(testSamples, 0.0);
+	for(size_t epoch = 0; epoch != options.fineTuneEpochs; ++epoch)
+		net.momentumSGDEpoch(trainSamples, 10, 0.05, 1.0, 0.5);
+	std::cout << "," << (double)net.evaluate(testSamples, compare) / testSamples.size() << "," << net.cost(testSamples, 0.0) << "\n";
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+	try {
+		Options options = parseOptions(argc, argv);
+
+		nn::setRandomSeed(options.seed);
+		nn::Network net{options.topology, nn::sigmoid, nn::crossEntropyCost};
+		if (!options.model.empty()) {
+			std::ifstream file{options.model};
+			if (!file)
+				throw std::runtime_error{"Could not open " + options.model};
+			file >> net;
+			options.topology.clear();
+			for(auto&& layer : net.m_nodes)
+				options.topology.push_back(layer.size());
+		}
+
+		std::vector<Sample> trainSamples = generateSamples(options, options.topology, options.seed);
+		const std::vector<Sample> testSamples = generateSamples(options, options.topology, options.seed + 1);
+		if (options.model.empty()) {
+			for(size_t epoch = 0; epoch != options.epochs; ++epoch)
+				net.momentumSGDEpoch(trainSamples, 10, 0.1, 1.0, 0.5);
+		}
+
+		std::stringstream saved;
+		saved << net;
+
+		std::cout << "rank,parameters,calculate_us,accuracy,cost,tuned_accuracy,tuned_cost\n";
+		printRow("full", net, trainSamples, testSamples, options);
+		for(auto&& rank : options.ranks) {
+			nn::Network factorized{nn::sigmoid, nn::crossEntropyCost};
+			std::stringstream{saved.str()} >> factorized;
+			factorized.factorizeLayer(options.layer, rank);
+			printRow(std::to_string(rank), factorized, trainSamples, testSamples, options);
+		}
+	} catch(const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+}
@@ -1,10 +1,12 @@
 #include "nn/Network.hpp"
+#include "nn/Augmentation.hpp"
 #include "deb.hpp"
 #include <iomanip>
 #include <vector>
 #include <fstream>
 #include <random>
 #include <algorithm>
+#include <memory>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -61,18 +63,45 @@ std::pair<std::vector<Sample>, std::vector<Sample>> getImages(size_t trainCount
     return {train, test};
 }
 
+std::unique_ptr<nn::Network> loadNetwork() {
+    std::ifstream fin{"network_images.txt"};
+    if (fin) {
+        std::cout<<"Loading network..."<<std::flush;
+        auto net = std::make_unique<nn::Network>(nn::fastSigmoid, nn::crossEntropyCost);
+        fin >> *net;
+        std::cout<<"\rLoaded            \n";
+        return net;
+    }
+
+    // convolutional autoencoder: every layer halves (or doubles) the width and
+    // height of the images, with only a few thousand shared weights instead of
+    // the 12288 weights of every node of a fully connected first layer
+    const nn::Conv2D encoder1{{IMAGE_SIZE, IMAGE_SIZE, 3}, 16, 4, 2, 1};
+    const nn::Conv2D encoder2{encoder1.outputShape(), 32, 4, 2, 1};
+    const nn::ConvTranspose2D decoder1{encoder2.outputShape(), 16, 4, 2, 1};
+    const nn::ConvTranspose2D decoder2{decoder1.outputShape(), 3, 4, 2, 1};
+    return std::make_unique<nn::Network>(
+        std::vector<size_t>{IMAGE_SIZE*IMAGE_SIZE*3, encoder1.outputShape().size(), encoder2.outputShape().size(),
+            decoder1.outputShape().size(), decoder2.outputShape().size()},
+        std::vector<nn::ActivationFunction*>{&nn::rectifiedLinear, &nn::rectifiedLinear, &nn::rectifiedLinear, &nn::fastSigmoid},
+        std::vector<const nn::Layer*>{&encoder1, &encoder2, &decoder1, &decoder2},
+        nn::crossEntropyCost);
+}
+
 int main() {
-	nn::Network net{nn::fastSigmoid, nn::crossEntropyCost};
-    std::cout<<"Loading network..."<<std::flush;
-	std::ifstream fin{"network_images.txt"};
-    fin >> net;
-    fin.close();
-    std::cout<<"\rLoaded            \n";
+	std::unique_ptr<nn::Network> net = loadNetwork();
     auto [trainImages, testImages] = getImages(11000, 2233);
 
-	net.momentumSGD(trainImages, 1, 50, 0.1 , 6.0, 0.5 , testImages, std::cout, compare);
+    nn::ImageAugmenter::Options augmentation{IMAGE_SIZE, IMAGE_SIZE, 3};
+    augmentation.maxShift = 2.0;
+    augmentation.maxRotation = 0.1;
+    augmentation.noiseStandardDeviation = 0.01;
+    augmentation.horizontalFlip = true;
+    nn::AugmentingSource augmentedTrainImages{trainImages, nn::ImageAugmenter{augmentation}};
+
+	net->momentumSGD(augmentedTrainImages, 1, 50, 0.1 , 6.0, 0.5 , testImages, std::cout, compare);
 
 	std::ofstream fout{"network_images_1.txt"};
-	fout << net;
+	fout << *net;
 	fout.close();
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "nn/Network.hpp"
+#include "nn/Augmentation.hpp"
+#include "nn/SparseNetwork.hpp"
 #include "deb.hpp"
 #include <iomanip>
 #include <vector>
@@ -75,10 +77,27 @@ int mnist_main() {
 	// fin >> net;
 	// fin.close();
 
-	net.momentumSGD(trainImages,  2, 10, 0.15, 4.0, 0.8 , testImages, std::cout, compare);
-	net.momentumSGD(trainImages,  3, 10, 0.1 , 4.0, 0.3 , testImages, std::cout, compare);
-	net.momentumSGD(trainImages,  5, 10, 0.1 , 4.5, 0.1 , testImages, std::cout, compare);
-	net.momentumSGD(trainImages, 10, 10, 0.08, 4.5, 0.02, testImages, std::cout, compare);
+	// digits must not be flipped, but small shifts, rotations and elastic distortions keep them valid
+	nn::ImageAugmenter::Options augmentation{28, 28, 1};
+	augmentation.maxShift = 2.0;
+	augmentation.maxRotation = 0.15;
+	augmentation.elasticAlpha = 1.5;
+	augmentation.elasticSigma = 4.0;
+	nn::AugmentingSource augmentedTrainImages{trainImages, nn::ImageAugmenter{augmentation}};
+
+	// every stage continues where the previous one ended, so only a subset of the
+	// test images is evaluated in between, while the SGD stages evaluate all of them
+	nn::EvaluationSchedule evaluationSchedule;
+	evaluationSchedule.beforeTraining = false;
+	evaluationSchedule.subsetSize = 2000;
+	evaluationSchedule.computeCost = false;
+	evaluationSchedule.background = true;
+	net.setEvaluationSchedule(evaluationSchedule);
+
+	net.momentumSGD(augmentedTrainImages,  2, 10, 0.15, 4.0, 0.8 , testImages, std::cout, compare);
+	net.momentumSGD(augmentedTrainImages,  3, 10, 0.1 , 4.0, 0.3 , testImages, std::cout, compare);
+	net.momentumSGD(augmentedTrainImages,  5, 10, 0.1 , 4.5, 0.1 , testImages, std::cout, compare);
+	net.momentumSGD(augmentedTrainImages, 10, 10, 0.08, 4.5, 0.02, testImages, std::cout, compare);
 	net.        SGD(trainImages, 25, 15, 0.07, 5.0,       testImages, std::cout, compare);
 	net.        SGD(trainImages, 25, 20, 0.06, 5.0,       testImages, std::cout, compare);
 
@@ -99,6 +118,14 @@ int mnist_main() {
 	fout << net;
 	fout.close();
 
+	// most weights end up near 0: keep a tenth of them, fine-tune those, and
+	// export them in the sparse format, which is smaller and faster to calculate
+	net.pruneByMagnitude(0.9);
+	net.momentumSGD(trainImages, 3, 10, 0.05, 5.0, 0.1, testImages, std::cout, compare);
+	std::ofstream sparseOut{"network-sparse.txt"};
+	sparseOut << nn::SparseNetwork{net};
+	sparseOut.close();
+
 //	nn::Network net{5,3,3,4};
 //
 //	std::cout << std::fixed << std::setprecision(1);
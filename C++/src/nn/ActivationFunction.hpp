@@ -3,6 +3,9 @@
 
 #include "utils.hpp"
 #include <cmath>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
 
 namespace nn {
 
@@ -10,6 +13,44 @@ class ActivationFunction {
 public:
 	virtual flt_t operator()(const flt_t z) const = 0;
 	virtual flt_t derivative(const flt_t z) const = 0;
+
+	/**
+	 * @brief the name under which the function is saved in model files
+	 * @see activationFunctionByName
+	 */
+	virtual const char* name() const = 0;
+
+	/**
+	 * @brief whether every activation depends only on its own z; if not, the
+	 *   function can only be applied to a whole layer, and only to the output
+	 *   layer together with a cost function that supports it
+	 * @see CostFunction::isDifference
+	 */
+	virtual bool isElementwise() const {
+		return true;
+	}
+
+	/**
+	 * @brief applies the function to a whole layer at once, with a single
+	 *   virtual call; functions without `exp` override it with branch-free
+	 *   loops that the compiler vectorizes
+	 * @param z the weighted sums of the layer
+	 * @param a where to write the activations, may be the same as z
+	 * @param count the size of the layer
+	 */
+	virtual void apply(const flt_t* z, flt_t* a, const size_t count) const {
+		for(size_t i = 0; i != count; ++i)
+			a[i] = (*this)(z[i]);
+	}
+
+	/**
+	 * @brief calculates the derivative for a whole layer at once
+	 * @see apply
+	 */
+	virtual void derivatives(const flt_t* z, flt_t* d, const size_t count) const {
+		for(size_t i = 0; i != count; ++i)
+			d[i] = derivative(z[i]);
+	}
 };
 
 class Sigmoid : public ActivationFunction {
@@ -23,6 +64,9 @@ class Sigmoid : public ActivationFunction {
 		const flt_t exp = std::exp(-std::abs(z));
 		return exp / std::pow(1+exp, 2);
 	}
+	const char* name() const final {
+		return "sigmoid";
+	}
 };
 inline Sigmoid sigmoid;
 
@@ -34,6 +78,9 @@ class FastSigmoid : public ActivationFunction {
 		const flt_t denom = std::abs(z) + 1;
 		return 0.5 / (denom * denom);
 	}
+	const char* name() const final {
+		return "fastSigmoid";
+	}
 };
 inline FastSigmoid fastSigmoid;
 
@@ -45,6 +92,9 @@ class Tanh : public ActivationFunction {
 		const flt_t res = 1.0 / std::cosh(z);
 		return res * res / 2.0;
 	}
+	const char* name() const final {
+		return "tanh";
+	}
 };
 inline Tanh tanh;
 
@@ -56,6 +106,9 @@ class Linear : public ActivationFunction {
 	flt_t derivative(const flt_t) const final {
 		return 1.0;
 	}
+	const char* name() const final {
+		return "linear";
+	}
 };
 inline Linear linear;
 
@@ -69,9 +122,140 @@ class RectifiedLinear : public ActivationFunction {
 		if (z < 0) return 0.0;
 		else return 1.0;
 	}
+	const char* name() const final {
+		return "rectifiedLinear";
+	}
+	void apply(const flt_t* z, flt_t* a, const size_t count) const final {
+		for(size_t i = 0; i != count; ++i)
+			a[i] = std::max(z[i], (flt_t)0.0);
+	}
+	void derivatives(const flt_t* z, flt_t* d, const size_t count) const final {
+		for(size_t i = 0; i != count; ++i)
+			d[i] = z[i] < 0 ? 0.0 : 1.0;
+	}
 };
 inline RectifiedLinear rectifiedLinear;
 
+// Like RectifiedLinear, but negative inputs keep a small slope so that nodes can not die.
+// This does not work with cost functions that require the output to be positive
+class LeakyRectifiedLinear : public ActivationFunction {
+	static constexpr flt_t slope = 0.01;
+
+	flt_t operator()(const flt_t z) const final {
+		return z < 0 ? slope * z : z;
+	}
+	flt_t derivative(const flt_t z) const final {
+		return z < 0 ? slope : 1.0;
+	}
+	const char* name() const final {
+		return "leakyRectifiedLinear";
+	}
+	void apply(const flt_t* z, flt_t* a, const size_t count) const final {
+		for(size_t i = 0; i != count; ++i)
+			a[i] = std::max(z[i], slope * z[i]);
+	}
+	void derivatives(const flt_t* z, flt_t* d, const size_t count) const final {
+		for(size_t i = 0; i != count; ++i)
+			d[i] = z[i] < 0 ? slope : 1.0;
+	}
+};
+inline LeakyRectifiedLinear leakyRectifiedLinear;
+
+// Piecewise linear approximation of Sigmoid, with the same slope in 0
+class HardSigmoid : public ActivationFunction {
+	flt_t operator()(const flt_t z) const final {
+		return std::clamp((flt_t)(0.25*z + 0.5), (flt_t)0.0, (flt_t)1.0);
+	}
+	flt_t derivative(const flt_t z) const final {
+		return std::abs(z) < 2 ? 0.25 : 0.0;
+	}
+	const char* name() const final {
+		return "hardSigmoid";
+	}
+	void apply(const flt_t* z, flt_t* a, const size_t count) const final {
+		for(size_t i = 0; i != count; ++i)
+			a[i] = std::min(std::max((flt_t)(0.25*z[i] + 0.5), (flt_t)0.0), (flt_t)1.0);
+	}
+	void derivatives(const flt_t* z, flt_t* d, const size_t count) const final {
+		for(size_t i = 0; i != count; ++i)
+			d[i] = std::abs(z[i]) < 2 ? 0.25 : 0.0;
+	}
+};
+inline HardSigmoid hardSigmoid;
+
+// Unlike Tanh, this is not scaled to [0, 1]: its outputs are in [-1, 1].
+// This does not work with cost functions that require the output to be positive
+class HardTanh : public ActivationFunction {
+	flt_t operator()(const flt_t z) const final {
+		return std::clamp(z, (flt_t)-1.0, (flt_t)1.0);
+	}
+	flt_t derivative(const flt_t z) const final {
+		return std::abs(z) < 1 ? 1.0 : 0.0;
+	}
+	const char* name() const final {
+		return "hardTanh";
+	}
+	void apply(const flt_t* z, flt_t* a, const size_t count) const final {
+		for(size_t i = 0; i != count; ++i)
+			a[i] = std::min(std::max(z[i], (flt_t)-1.0), (flt_t)1.0);
+	}
+	void derivatives(const flt_t* z, flt_t* d, const size_t count) const final {
+		for(size_t i = 0; i != count; ++i)
+			d[i] = std::abs(z[i]) < 1 ? 1.0 : 0.0;
+	}
+};
+inline HardTanh hardTanh;
+
+// Normalizes the outputs of a layer into probabilities that sum to 1, so it can only be
+// used for the output layer, together with CategoricalCrossEntropyCost
+class Softmax : public ActivationFunction {
+	flt_t operator()(const flt_t) const final {
+		throw std::runtime_error{"Softmax can only be applied to a whole layer"};
+	}
+	flt_t derivative(const flt_t) const final {
+		throw std::runtime_error{"Softmax has no derivative on its own, use it with CategoricalCrossEntropyCost"};
+	}
+	const char* name() const final {
+		return "softmax";
+	}
+	bool isElementwise() const final {
+		return false;
+	}
+	void apply(const flt_t* z, flt_t* a, const size_t count) const final {
+		// subtracting the largest z prevents exp from overflowing, without changing the result
+		const flt_t max = *std::max_element(z, z + count);
+		flt_t sum = 0.0;
+		for(size_t i = 0; i != count; ++i) {
+			a[i] = std::exp(z[i] - max);
+			sum += a[i];
+		}
+		const flt_t inverseSum = 1.0 / sum;
+		for(size_t i = 0; i != count; ++i)
+			a[i] *= inverseSum;
+	}
+	void derivatives(const flt_t*, flt_t*, const size_t) const final {
+		throw std::runtime_error{"Softmax has no derivative on its own, use it with CategoricalCrossEntropyCost"};
+	}
+};
+inline Softmax softmax;
+
+/**
+ * @brief finds a built-in activation function from its name
+ * @param name @see ActivationFunction::name
+ * @return the activation function, or nullptr if there is none with that name
+ */
+inline ActivationFunction* activationFunctionByName(const std::string& name) {
+	ActivationFunction* const functions[] = {
+		&sigmoid, &fastSigmoid, &tanh, &linear, &rectifiedLinear,
+		&leakyRectifiedLinear, &hardSigmoid, &hardTanh, &softmax,
+	};
+	for(auto&& function : functions) {
+		if (name == function->name())
+			return function;
+	}
+	return nullptr;
+}
+
 } // namespace nn
 
 #endif // _NN_ACTIVATIONFUNCTION_HPP_
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "Aligned.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace nn {
+
+namespace {
+	constexpr size_t hugePageSize = 2 << 20;
+
+	std::atomic<bool> hugePages{false};
+
+	size_t roundUp(const size_t bytes, const size_t multiple) {
+		return (bytes + multiple - 1) / multiple * multiple;
+	}
+}
+
+void* alignedAllocate(const size_t bytes) {
+	void* pointer;
+#ifdef __linux__
+	if (hugePages && bytes >= hugePageSize) {
+		// madvise works on whole pages: the buffer must not share them
+		const size_t size = roundUp(bytes, hugePageSize);
+		pointer = std::aligned_alloc(hugePageSize, size);
+		if (pointer == nullptr)
+			throw std::bad_alloc{};
+		madvise(pointer, size, MADV_HUGEPAGE); // only advice: the buffer works anyway
+		return pointer;
+	}
+#endif
+	// aligned_alloc needs a multiple of the alignment, and may return nullptr for 0
+	pointer = std::aligned_alloc(alignment, roundUp(std::max<size_t>(bytes, 1), alignment));
+	if (pointer == nullptr)
+		throw std::bad_alloc{};
+	return pointer;
+}
+
+void alignedFree(void* pointer) {
+	std::free(pointer);
+}
+
+bool setHugePages(const bool enabled) {
+#ifdef __linux__
+	hugePages = enabled;
+	return true;
+#else
+	return !enabled;
+#endif
+}
+
+} /* namespace nn */
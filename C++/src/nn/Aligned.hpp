@@ -0,0 +1,179 @@
+#ifndef _NN_ALIGNED_HPP_
+#define _NN_ALIGNED_HPP_
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include "utils.hpp"
+
+namespace nn {
+
+/**
+ * @brief the alignment of the buffers of parameters and activations: a cache
+ *   line, which is also the size of the widest SIMD registers (AVX-512)
+ */
+constexpr size_t alignment = 64;
+
+/**
+ * @brief how many flt_t fit in the widest SIMD registers, and so the multiple
+ *   to which the rows of weights are padded
+ */
+constexpr size_t simdWidth = alignment / sizeof(flt_t);
+
+/**
+ * @return count rounded up to a multiple of simdWidth
+ */
+constexpr size_t paddedSize(const size_t count) {
+	return (count + simdWidth - 1) / simdWidth * simdWidth;
+}
+
+/**
+ * @brief tells the compiler that a pointer is aligned to `alignment`, as the
+ *   buffers of AlignedAllocator are, so that the loops it vectorizes use
+ *   aligned loads without peeling the first iterations
+ */
+template<class T>
+T* assumeAligned(T* pointer) {
+	return static_cast<T*>(__builtin_assume_aligned(pointer, alignment));
+}
+
+/**
+ * @brief allocates memory aligned to `alignment`, or to a huge page if huge
+ *   pages are enabled and it is at least that big
+ * @param bytes the size of the memory
+ * @return the memory, to be released with alignedFree
+ * @throws std::bad_alloc if there is not enough memory
+ * @see setHugePages
+ */
+void* alignedAllocate(const size_t bytes);
+
+/**
+ * @brief releases memory allocated by alignedAllocate
+ */
+void alignedFree(void* pointer);
+
+/**
+ * @brief enables or disables asking the kernel to back the buffers of at least
+ *   a huge page (2 MiB) with huge pages, with madvise(MADV_HUGEPAGE), which
+ *   saves TLB misses on large layers. Only applies to the buffers allocated
+ *   afterwards. Disabled by default, since every such buffer is rounded up
+ *   to a whole huge page.
+ * @param enabled whether to use huge pages
+ * @return `false` if huge pages are not supported (e.g. not Linux)
+ */
+bool setHugePages(const bool enabled);
+
+/**
+ * @brief allocator of standard containers whose elements start on a cache line
+ * @see alignedAllocate
+ */
+template<class T>
+struct AlignedAllocator {
+	using value_type = T;
+
+	AlignedAllocator() = default;
+	template<class U>
+	AlignedAllocator(const AlignedAllocator<U>&) {}
+
+	T* allocate(const size_t count) {
+		return static_cast<T*>(alignedAllocate(count * sizeof(T)));
+	}
+	void deallocate(T* pointer, const size_t) {
+		alignedFree(pointer);
+	}
+
+	template<class U>
+	bool operator==(const AlignedAllocator<U>&) const {
+		return true;
+	}
+	template<class U>
+	bool operator!=(const AlignedAllocator<U>&) const {
+		return false;
+	}
+};
+
+template<class T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+/**
+ * @brief an aligned array whose storage is padded to a multiple of simdWidth
+ *   elements, whose padding lanes are always 0. It behaves like a vector of
+ *   its size, but kernels can process paddedSize() elements without a tail
+ *   loop: e.g. weights, nablas and inputs that are 0 in the padding add
+ *   nothing to dot products and updates, and leave the padding at 0.
+ */
+template<class T>
+class PaddedVector {
+public:
+	PaddedVector() = default;
+
+	explicit PaddedVector(const size_t size) :
+			m_size{size}, m_data(nn::paddedSize(size)) {}
+
+	size_t size() const {
+		return m_size;
+	}
+	size_t paddedSize() const {
+		return m_data.size();
+	}
+	size_t capacity() const {
+		return m_data.capacity();
+	}
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	T* data() {
+		return m_data.data();
+	}
+	const T* data() const {
+		return m_data.data();
+	}
+	T* begin() {
+		return m_data.data();
+	}
+	const T* begin() const {
+		return m_data.data();
+	}
+	T* end() {
+		return m_data.data() + m_size;
+	}
+	const T* end() const {
+		return m_data.data() + m_size;
+	}
+	T& operator[](const size_t index) {
+		return m_data[index];
+	}
+	const T& operator[](const size_t index) const {
+		return m_data[index];
+	}
+
+	/**
+	 * @brief keeps the first elements, and sets the new ones to 0
+	 */
+	void resize(const size_t size) {
+		m_data.resize(nn::paddedSize(size));
+		if (size < m_size)
+			std::fill(m_data.begin() + size, m_data.end(), T{});
+		m_size = size;
+	}
+
+	void assign(const size_t size, const T& value) {
+		m_data.assign(nn::paddedSize(size), T{});
+		std::fill(m_data.begin(), m_data.begin() + size, value);
+		m_size = size;
+	}
+
+	void clear() {
+		m_data.clear();
+		m_size = 0;
+	}
+
+private:
+	size_t m_size = 0;
+	AlignedVector<T> m_data;
+};
+
+} // namespace nn
+
+#endif // _NN_ALIGNED_HPP_
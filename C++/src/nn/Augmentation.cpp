@@ -0,0 +1,261 @@
+#include "Augmentation.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+
+namespace nn {
+
+namespace {
+	// std::floor may be a call, which keeps the coordinate loop from being vectorized
+	inline int floorToInt(const flt_t value) {
+		const int truncated = (int)value;
+		return truncated - (value < truncated);
+	}
+}
+
+ImageAugmenter::ImageAugmenter(const Options& options) :
+		m_options{options}, m_gaussianKernel{} {
+	if (m_options.elasticAlpha != 0) {
+		const int radius = std::max(1, (int)std::ceil(3 * m_options.elasticSigma));
+		m_gaussianKernel.resize(2*radius + 1);
+		for(int i = -radius; i <= radius; ++i) {
+			m_gaussianKernel[i + radius] = std::exp(-0.5 * i*i / (m_options.elasticSigma * m_options.elasticSigma));
+		}
+		const flt_t sum = std::accumulate(m_gaussianKernel.begin(), m_gaussianKernel.end(), (flt_t)0.0);
+		for(auto&& k : m_gaussianKernel)
+			k /= sum;
+	}
+}
+
+void ImageAugmenter::elasticField(State& state) const {
+	const size_t width = m_options.width, height = m_options.height;
+	const int radius = m_gaussianKernel.size() / 2;
+	std::uniform_real_distribution<flt_t> uniform{-1.0, 1.0};
+
+	// smooth a uniform random field with a separable gaussian blur (zero padded)
+	auto blur = [&](std::vector<flt_t>& field) {
+		for(size_t y = 0; y != height; ++y) {
+			for(size_t x = 0; x != width; ++x) {
+				flt_t acc = 0;
+				for(int k = -radius; k <= radius; ++k) {
+					const int xs = (int)x + k;
+					if (xs >= 0 && xs < (int)width)
+						acc += m_gaussianKernel[k + radius] * field[y*width + xs];
+				}
+				state.tmp[y*width + x] = acc;
+			}
+		}
+		for(size_t y = 0; y != height; ++y) {
+			for(size_t x = 0; x != width; ++x) {
+				flt_t acc = 0;
+				for(int k = -radius; k <= radius; ++k) {
+					const int ys = (int)y + k;
+					if (ys >= 0 && ys < (int)height)
+						acc += m_gaussianKernel[k + radius] * state.tmp[ys*width + x];
+				}
+				field[y*width + x] = m_options.elasticAlpha * acc;
+			}
+		}
+	};
+
+	state.dx.resize(width * height);
+	state.dy.resize(width * height);
+	state.tmp.resize(width * height);
+	for(auto&& d : state.dx)
+		d = uniform(state.engine);
+	for(auto&& d : state.dy)
+		d = uniform(state.engine);
+	blur(state.dx);
+	blur(state.dy);
+}
+
+void ImageAugmenter::operator()(const std::vector<flt_t>& image, std::vector<flt_t>& result, State& state) const {
+	const size_t width = m_options.width, height = m_options.height, channels = m_options.channels;
+	result.resize(width * height * channels);
+
+	std::uniform_real_distribution<flt_t> shiftDistribution{-m_options.maxShift, m_options.maxShift};
+	std::uniform_real_distribution<flt_t> rotationDistribution{-m_options.maxRotation, m_options.maxRotation};
+	const flt_t shiftX = shiftDistribution(state.engine), shiftY = shiftDistribution(state.engine);
+	const flt_t angle = rotationDistribution(state.engine);
+	const bool flip = m_options.horizontalFlip && std::bernoulli_distribution{0.5}(state.engine);
+	const bool elastic = m_options.elasticAlpha != 0;
+	if (elastic)
+		elasticField(state);
+
+	const flt_t cos = std::cos(angle), sin = std::sin(angle);
+	const flt_t centerX = (width - 1) / 2.0, centerY = (height - 1) / 2.0;
+	// the flip as arithmetic, so that the coordinate loop has no branch
+	const flt_t flipSign = flip ? -1 : 1, flipOffset = flip ? width - 1 : 0;
+
+	// a copy of the image with a border of zeros, so that every bilinear tap
+	// of a coordinate clamped to [-1, width] x [-1, height] is in the buffer
+	const size_t paddedWidth = width + 2, rowStride = paddedWidth * channels;
+	state.padded.assign(paddedWidth * (height + 2) * channels, 0.0);
+	for(size_t y = 0; y != height; ++y) {
+		std::copy_n(image.begin() + y*width*channels, width*channels,
+			state.padded.begin() + (y+1)*rowStride + channels);
+	}
+	state.srcX.resize(width);
+	state.srcY.resize(width);
+	state.offsets.resize(width);
+	flt_t* srcX = state.srcX.data();
+	flt_t* srcY = state.srcY.data();
+	uint32_t* offsets = state.offsets.data();
+
+	for(size_t y = 0; y != height; ++y) {
+		// map the destination row back onto the original image:
+		// undo the shift, then the rotation around the center, then the flip
+		const flt_t fy = y - centerY - shiftY;
+		for(int x = 0; x != (int)width; ++x) {
+			const flt_t fx = x - centerX - shiftX;
+			srcX[x] = cos*fx + sin*fy + centerX;
+			srcY[x] = -sin*fx + cos*fy + centerY;
+		}
+		if (elastic) {
+			for(size_t x = 0; x != width; ++x) {
+				srcX[x] += state.dx[y*width + x];
+				srcY[x] += state.dy[y*width + x];
+			}
+		}
+
+		// the top left tap and the weights of the right and bottom ones: a
+		// coordinate outside the image samples only the border of zeros
+		for(int x = 0; x != (int)width; ++x) {
+			const flt_t cx = std::clamp(flipOffset + flipSign * srcX[x], (flt_t)-1.0, (flt_t)width);
+			const flt_t cy = std::clamp(srcY[x], (flt_t)-1.0, (flt_t)height);
+			const int x0 = std::min(floorToInt(cx), (int)width - 1);
+			const int y0 = std::min(floorToInt(cy), (int)height - 1);
+			srcX[x] = cx - x0;
+			srcY[x] = cy - y0;
+			offsets[x] = (y0 + 1) * rowStride + (x0 + 1) * channels;
+		}
+
+		flt_t* row = result.data() + y*width*channels;
+		for(size_t x = 0; x != width; ++x) {
+			const flt_t* p = state.padded.data() + offsets[x];
+			const flt_t wx = srcX[x], wy = srcY[x];
+			for(size_t c = 0; c != channels; ++c) {
+				row[x*channels + c] =
+					(1-wy) * ((1-wx) * p[c]             + wx * p[channels + c]) +
+					   wy  * ((1-wx) * p[rowStride + c] + wx * p[rowStride + channels + c]);
+			}
+		}
+	}
+
+	if (m_options.noiseStandardDeviation != 0) {
+		std::normal_distribution<flt_t> noise{0.0, m_options.noiseStandardDeviation};
+		for(auto&& value : result)
+			value += noise(state.engine);
+	}
+	for(auto&& value : result)
+		value = std::clamp(value, (flt_t)0.0, (flt_t)1.0);
+}
+
+
+AugmentingSource::AugmentingSource(const std::vector<Sample>& samples,
+		const ImageAugmenter& augmenter,
+		const size_t workerCount,
+		const size_t queueCapacity,
+		const unsigned int seed) :
+		m_samples{samples}, m_augmenter{augmenter},
+		m_queueCapacity{std::max<size_t>(1, queueCapacity)}, m_engine{seed},
+		m_order(samples.size()), m_batchSize{1}, m_batchCount{0},
+		m_nextJob{0}, m_activeJobs{0}, m_retrieved{0},
+		m_ready{}, m_stopping{false} {
+	std::iota(m_order.begin(), m_order.end(), 0);
+	for(size_t w = 0; w != std::max<size_t>(1, workerCount); ++w) {
+		m_workers.emplace_back(&AugmentingSource::work, this, seed + 1 + w);
+	}
+}
+
+AugmentingSource::~AugmentingSource() {
+	{
+		std::lock_guard lock{m_mutex};
+		m_stopping = true;
+	}
+	m_workAvailable.notify_all();
+	for(auto&& worker : m_workers)
+		worker.join();
+}
+
+void AugmentingSource::rewind(const size_t batchSize) {
+	std::unique_lock lock{m_mutex};
+
+	// stop handing out jobs of the previous pass and wait for the running ones,
+	// since they still read m_order
+	m_nextJob = m_batchCount;
+	m_idle.wait(lock, [this]{ return m_activeJobs == 0; });
+	m_ready.clear();
+
+	std::shuffle(m_order.begin(), m_order.end(), m_engine);
+	m_batchSize = std::max<size_t>(1, batchSize);
+	m_batchCount = (m_samples.size() + m_batchSize - 1) / m_batchSize;
+	m_nextJob = 0;
+	m_retrieved = 0;
+	lock.unlock();
+	m_workAvailable.notify_all();
+}
+
+bool AugmentingSource::nextBatch(std::vector<Sample>& batch) {
+	std::unique_lock lock{m_mutex};
+	if (m_retrieved == m_batchCount) {
+		batch.clear();
+		return false;
+	}
+
+	m_batchReady.wait(lock, [this]{ return !m_ready.empty(); });
+	batch = std::move(m_ready.front());
+	m_ready.pop_front();
+	++m_retrieved;
+	lock.unlock();
+	m_workAvailable.notify_one();
+	return true;
+}
+
+size_t AugmentingSource::size() const {
+	return m_samples.size();
+}
+
+void AugmentingSource::work(const unsigned int seed) {
+	ImageAugmenter::State state{seed};
+	std::vector<flt_t> augmented;
+
+	std::unique_lock lock{m_mutex};
+	while(1) {
+		m_workAvailable.wait(lock, [this]{
+			return m_stopping || (m_nextJob < m_batchCount
+				&& m_ready.size() + m_activeJobs < m_queueCapacity);
+		});
+		if (m_stopping)
+			return;
+
+		const size_t begin = m_nextJob * m_batchSize;
+		const size_t end = std::min(begin + m_batchSize, m_samples.size());
+		++m_nextJob;
+		++m_activeJobs;
+		lock.unlock();
+
+		std::vector<Sample> batch;
+		batch.reserve(end - begin);
+		for(size_t i = begin; i != end; ++i) {
+			const Sample& sample = m_samples[m_order[i]];
+			m_augmenter(sample.getInputs(), augmented, state);
+			if (sample.isAutoclassifier())
+				batch.emplace_back(augmented);
+			else if (sample.hasOnlyExpectedClass())
+				batch.emplace_back(augmented, sample.getExpectedClass());
+			else
+				batch.emplace_back(augmented, sample.getExpectedOutputs());
+		}
+
+		lock.lock();
+		m_ready.push_back(std::move(batch));
+		--m_activeJobs;
+		m_batchReady.notify_one();
+		if (m_activeJobs == 0)
+			m_idle.notify_all();
+	}
+}
+
+} /* namespace nn */
@@ -0,0 +1,116 @@
+#ifndef _NN_AUGMENTATION_HPP_
+#define _NN_AUGMENTATION_HPP_
+
+#include <vector>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <cstdint>
+#include "utils.hpp"
+#include "Sample.hpp"
+#include "SampleSource.hpp"
+
+namespace nn {
+
+/**
+ * @brief applies random geometric and photometric distortions to images.
+ *   Shift, rotation, horizontal flip and elastic distortion are combined into a
+ *   single displacement of the sampling grid, so every image is resampled
+ *   (bilinearly) only once, and noise is added in the same sweep.
+ *   Pixels are expected in row-major order with interleaved channels, i.e.
+ *   `image[(y*width + x)*channels + c]`, as read by both MNIST and stb_image.
+ */
+class ImageAugmenter {
+public:
+	struct Options {
+		size_t width, height, channels;
+		flt_t maxShift = 0; // in pixels, in both directions
+		flt_t maxRotation = 0; // in radians, in both directions
+		flt_t elasticAlpha = 0; // scale of the elastic displacement field, 0 to disable
+		flt_t elasticSigma = 4; // smoothness of the elastic displacement field, in pixels
+		flt_t noiseStandardDeviation = 0; // of the additive gaussian noise
+		bool horizontalFlip = false; // flip half of the images (only for faces, not digits)
+	};
+
+	/**
+	 * @brief per-thread random engine and scratch buffers, so that augmenting
+	 *   does not allocate after the first image: the elastic field, the image
+	 *   with a border of zeros, and the source coordinates of a row
+	 */
+	struct State {
+		std::mt19937 engine;
+		std::vector<flt_t> dx, dy, tmp;
+		std::vector<flt_t> padded, srcX, srcY;
+		std::vector<uint32_t> offsets;
+
+		State(const unsigned int seed) : engine{seed} {}
+	};
+
+	ImageAugmenter(const Options& options);
+
+	/**
+	 * @brief writes a randomly distorted version of `image` into `result`
+	 * @param image the original image of width*height*channels pixels in [0, 1]
+	 * @param result where to save the augmented image, resized if needed
+	 * @param state the random engine and buffers of the calling thread
+	 */
+	void operator()(const std::vector<flt_t>& image, std::vector<flt_t>& result, State& state) const;
+
+private:
+	Options m_options;
+	std::vector<flt_t> m_gaussianKernel;
+
+	void elasticField(State& state) const;
+};
+
+/**
+ * @brief a SampleSource that augments the samples of an in-memory dataset on
+ *   the fly in background worker threads. Only a bounded number of augmented
+ *   mini batches exists at any time, so the augmented dataset is never
+ *   materialized as a whole. For autoclassifier samples the augmented image is
+ *   used also as expected output, otherwise the expected outputs are kept.
+ */
+class AugmentingSource : public SampleSource {
+public:
+	/**
+	 * @param samples the original samples; they must outlive the source
+	 * @param augmenter the augmentation to apply to the inputs of every sample
+	 * @param workerCount how many threads to augment with
+	 * @param queueCapacity the maximum number of ready batches waiting to be retrieved
+	 * @param seed seed for the shuffling and for the augmentation of every worker
+	 */
+	AugmentingSource(const std::vector<Sample>& samples,
+		const ImageAugmenter& augmenter,
+		const size_t workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1,
+		const size_t queueCapacity = 16,
+		const unsigned int seed = std::random_device{}());
+	~AugmentingSource() override;
+
+	void rewind(const size_t batchSize) override;
+	bool nextBatch(std::vector<Sample>& batch) override;
+	size_t size() const override;
+
+private:
+	const std::vector<Sample>& m_samples;
+	ImageAugmenter m_augmenter;
+	size_t m_queueCapacity;
+	std::mt19937 m_engine;
+
+	std::vector<size_t> m_order;
+	size_t m_batchSize, m_batchCount;
+	size_t m_nextJob, m_activeJobs, m_retrieved;
+	std::deque<std::vector<Sample>> m_ready;
+	bool m_stopping;
+
+	std::mutex m_mutex;
+	std::condition_variable m_workAvailable, m_batchReady, m_idle;
+	std::vector<std::thread> m_workers;
+
+	void work(const unsigned int seed);
+};
+
+} // namespace nn
+
+#endif // _NN_AUGMENTATION_HPP_
@@ -0,0 +1,240 @@
+#include "Convolution.hpp"
+#include "Gemm.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+namespace nn {
+
+namespace {
+	// the im2col matrices of infer, kept by every thread that infers
+	thread_local AlignedVector<flt_t> inferenceColumns;
+
+	size_t convolvedSize(const size_t size, const size_t kernelSize, const size_t stride, const size_t padding) {
+		if (size + 2*padding < kernelSize || stride == 0)
+			throw std::runtime_error{"Invalid convolution of size " + std::to_string(size) + " with kernel "
+				+ std::to_string(kernelSize) + ", stride " + std::to_string(stride)
+				+ " and padding " + std::to_string(padding)};
+		return (size + 2*padding - kernelSize) / stride + 1;
+	}
+
+	size_t transposedSize(const size_t size, const size_t kernelSize, const size_t stride, const size_t padding) {
+		if (size == 0 || stride == 0 || (size - 1) * stride + kernelSize <= 2*padding)
+			throw std::runtime_error{"Invalid transposed convolution of size " + std::to_string(size) + " with kernel "
+				+ std::to_string(kernelSize) + ", stride " + std::to_string(stride)
+				+ " and padding " + std::to_string(padding)};
+		return (size - 1) * stride + kernelSize - 2*padding;
+	}
+}
+
+Convolution::Convolution(const ImageShape& inputShape,
+		const ImageShape& outputShape,
+		const size_t kernelSize,
+		const size_t stride,
+		const size_t padding,
+		const size_t weightCount,
+		const size_t fanIn) :
+		Layer{weightCount, outputShape.channels, fanIn},
+		m_inputShape{inputShape}, m_outputShape{outputShape},
+		m_kernelSize{kernelSize}, m_stride{stride}, m_padding{padding},
+		m_columns{}, m_columnsGradient{} {}
+
+void Convolution::writeShape(std::ostream& out) const {
+	out << m_inputShape.width << " " << m_inputShape.height << " " << m_inputShape.channels << " "
+		<< m_outputShape.channels << " " << m_kernelSize << " " << m_stride << " " << m_padding << " ";
+}
+
+AlignedVector<flt_t>& Convolution::columns() {
+	if (!m_recomputation)
+		return m_columns;
+	AlignedVector<flt_t>{}.swap(m_columns);
+	return sharedBuffer(0);
+}
+
+AlignedVector<flt_t>& Convolution::columnsGradient() {
+	if (!m_recomputation)
+		return m_columnsGradient;
+	AlignedVector<flt_t>{}.swap(m_columnsGradient);
+	return sharedBuffer(1);
+}
+
+void Convolution::addBiases(flt_t* z, const size_t batchSize) const {
+	const size_t pixels = batchSize * m_outputShape.width * m_outputShape.height, channels = m_outputShape.channels;
+	for(size_t p = 0; p != pixels; ++p)
+		for(size_t c = 0; c != channels; ++c)
+			z[p*channels + c] += m_biases[c];
+}
+
+void Convolution::accumulateBiasesGradient(const flt_t* errors, const size_t batchSize) {
+	const size_t pixels = batchSize * m_outputShape.width * m_outputShape.height, channels = m_outputShape.channels;
+	for(size_t p = 0; p != pixels; ++p)
+		for(size_t c = 0; c != channels; ++c)
+			m_biasesGradient[c] += errors[p*channels + c];
+}
+
+void Convolution::im2col(const flt_t* image, const ImageShape& shape, const ImageShape& grid, flt_t* columns) const {
+	const size_t channels = shape.channels;
+	for(size_t gy = 0; gy != grid.height; ++gy) {
+		for(size_t gx = 0; gx != grid.width; ++gx) {
+			for(size_t ky = 0; ky != m_kernelSize; ++ky) {
+				// unsigned: pixels in the padding wrap around and are out of bounds
+				const size_t iy = gy * m_stride + ky - m_padding;
+				for(size_t kx = 0; kx != m_kernelSize; ++kx) {
+					const size_t ix = gx * m_stride + kx - m_padding;
+					if (iy < shape.height && ix < shape.width)
+						std::copy_n(image + (iy * shape.width + ix) * channels, channels, columns);
+					else
+						std::fill_n(columns, channels, (flt_t)0);
+					columns += channels;
+				}
+			}
+		}
+	}
+}
+
+void Convolution::col2im(const flt_t* columns, const ImageShape& shape, const ImageShape& grid, flt_t* image) const {
+	const size_t channels = shape.channels;
+	for(size_t gy = 0; gy != grid.height; ++gy) {
+		for(size_t gx = 0; gx != grid.width; ++gx) {
+			for(size_t ky = 0; ky != m_kernelSize; ++ky) {
+				const size_t iy = gy * m_stride + ky - m_padding;
+				for(size_t kx = 0; kx != m_kernelSize; ++kx) {
+					const size_t ix = gx * m_stride + kx - m_padding;
+					if (iy < shape.height && ix < shape.width) {
+						flt_t* pixel = image + (iy * shape.width + ix) * channels;
+						for(size_t c = 0; c != channels; ++c)
+							pixel[c] += columns[c];
+					}
+					columns += channels;
+				}
+			}
+		}
+	}
+}
+
+Conv2D::Conv2D(const ImageShape& inputShape,
+		const size_t outputChannels,
+		const size_t kernelSize,
+		const size_t stride,
+		const size_t padding) :
+		Convolution{inputShape,
+			{convolvedSize(inputShape.width, kernelSize, stride, padding),
+				convolvedSize(inputShape.height, kernelSize, stride, padding), outputChannels},
+			kernelSize, stride, padding,
+			outputChannels * kernelSize * kernelSize * inputShape.channels,
+			kernelSize * kernelSize * inputShape.channels} {}
+
+std::unique_ptr<Layer> Conv2D::clone() const {
+	return std::make_unique<Conv2D>(*this);
+}
+
+void Conv2D::forward(const flt_t* inputs, flt_t* z, const size_t batchSize) {
+	convolve(inputs, z, batchSize, columns());
+}
+
+void Conv2D::infer(const flt_t* inputs, flt_t* z, const size_t batchSize) const {
+	convolve(inputs, z, batchSize, inferenceColumns);
+}
+
+void Conv2D::convolve(const flt_t* inputs, flt_t* z, const size_t batchSize, AlignedVector<flt_t>& columns) const {
+	// z (pixels x output channels) = columns (pixels x patch) * weightsᵀ (patch x output channels),
+	// with the pixels of all the samples one after the other
+	const size_t pixels = m_outputShape.width * m_outputShape.height, patch = patchSize(m_inputShape);
+	const size_t channels = m_outputShape.channels;
+	columns.resize(batchSize * pixels * patch);
+	for(size_t b = 0; b != batchSize; ++b)
+		im2col(inputs + b * m_inputShape.size(), m_inputShape, m_outputShape, columns.data() + b * pixels * patch);
+	gemm(false, true, batchSize * pixels, channels, patch, 1, columns.data(), patch, m_weights.data(), patch, 0, z, channels);
+	addBiases(z, batchSize);
+}
+
+void Conv2D::backward(const flt_t* inputs, const flt_t* errors, flt_t* inputErrors, const size_t batchSize) {
+	const size_t pixels = m_outputShape.width * m_outputShape.height, patch = patchSize(m_inputShape);
+	const size_t channels = m_outputShape.channels;
+	AlignedVector<flt_t>& columns = this->columns();
+	if (m_recomputation) {
+		columns.resize(batchSize * pixels * patch);
+		for(size_t b = 0; b != batchSize; ++b)
+			im2col(inputs + b * m_inputShape.size(), m_inputShape, m_outputShape, columns.data() + b * pixels * patch);
+	} // else the columns of the inputs are still there from the forward pass
+	gemm(true, false, channels, patch, batchSize * pixels, 1, errors, channels, columns.data(), patch,
+		1, m_weightsGradient.data(), patch);
+	accumulateBiasesGradient(errors, batchSize);
+
+	if (inputErrors == nullptr)
+		return;
+	AlignedVector<flt_t>& columnsGradient = this->columnsGradient();
+	columnsGradient.resize(batchSize * pixels * patch);
+	gemm(false, false, batchSize * pixels, patch, channels, 1, errors, channels, m_weights.data(), patch,
+		0, columnsGradient.data(), patch);
+	std::fill_n(inputErrors, batchSize * m_inputShape.size(), (flt_t)0);
+	for(size_t b = 0; b != batchSize; ++b)
+		col2im(columnsGradient.data() + b * pixels * patch, m_inputShape, m_outputShape,
+			inputErrors + b * m_inputShape.size());
+}
+
+size_t Conv2D::multiplyAdds() const {
+	return m_outputShape.width * m_outputShape.height * m_weights.size();
+}
+
+
+ConvTranspose2D::ConvTranspose2D(const ImageShape& inputShape,
+		const size_t outputChannels,
+		const size_t kernelSize,
+		const size_t stride,
+		const size_t padding) :
+		Convolution{inputShape,
+			{transposedSize(inputShape.width, kernelSize, stride, padding),
+				transposedSize(inputShape.height, kernelSize, stride, padding), outputChannels},
+			kernelSize, stride, padding,
+			inputShape.channels * kernelSize * kernelSize * outputChannels,
+			std::max<size_t>(1, kernelSize * kernelSize * inputShape.channels / (stride * stride))} {}
+
+std::unique_ptr<Layer> ConvTranspose2D::clone() const {
+	return std::make_unique<ConvTranspose2D>(*this);
+}
+
+void ConvTranspose2D::forward(const flt_t* inputs, flt_t* z, const size_t batchSize) {
+	convolve(inputs, z, batchSize, columns());
+}
+
+void ConvTranspose2D::infer(const flt_t* inputs, flt_t* z, const size_t batchSize) const {
+	convolve(inputs, z, batchSize, inferenceColumns);
+}
+
+void ConvTranspose2D::convolve(const flt_t* inputs, flt_t* z, const size_t batchSize, AlignedVector<flt_t>& columns) const {
+	// columns (input pixels x patch) = inputs (input pixels x input channels) * weights (input channels x patch),
+	// then every row is added to the patch of the output it comes from
+	// (backward does not need the columns, so there is nothing to recompute)
+	const size_t pixels = m_inputShape.width * m_inputShape.height, patch = patchSize(m_outputShape);
+	columns.resize(batchSize * pixels * patch);
+	gemm(false, false, batchSize * pixels, patch, m_inputShape.channels, 1, inputs, m_inputShape.channels,
+		m_weights.data(), patch, 0, columns.data(), patch);
+	std::fill_n(z, batchSize * m_outputShape.size(), (flt_t)0);
+	for(size_t b = 0; b != batchSize; ++b)
+		col2im(columns.data() + b * pixels * patch, m_outputShape, m_inputShape, z + b * m_outputShape.size());
+	addBiases(z, batchSize);
+}
+
+void ConvTranspose2D::backward(const flt_t* inputs, const flt_t* errors, flt_t* inputErrors, const size_t batchSize) {
+	const size_t pixels = m_inputShape.width * m_inputShape.height, patch = patchSize(m_outputShape);
+	AlignedVector<flt_t>& columnsGradient = this->columnsGradient();
+	columnsGradient.resize(batchSize * pixels * patch);
+	for(size_t b = 0; b != batchSize; ++b)
+		im2col(errors + b * m_outputShape.size(), m_outputShape, m_inputShape, columnsGradient.data() + b * pixels * patch);
+	gemm(true, false, m_inputShape.channels, patch, batchSize * pixels, 1, inputs, m_inputShape.channels,
+		columnsGradient.data(), patch, 1, m_weightsGradient.data(), patch);
+	accumulateBiasesGradient(errors, batchSize);
+
+	if (inputErrors == nullptr)
+		return;
+	gemm(false, true, batchSize * pixels, m_inputShape.channels, patch, 1, columnsGradient.data(), patch,
+		m_weights.data(), patch, 0, inputErrors, m_inputShape.channels);
+}
+
+size_t ConvTranspose2D::multiplyAdds() const {
+	return m_inputShape.width * m_inputShape.height * m_weights.size();
+}
+
+} /* namespace nn */
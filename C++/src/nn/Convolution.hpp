@@ -0,0 +1,187 @@
+#ifndef _NN_CONVOLUTION_HPP_
+#define _NN_CONVOLUTION_HPP_
+
+#include <vector>
+#include <memory>
+#include <ostream>
+#include "utils.hpp"
+#include "Layer.hpp"
+
+namespace nn {
+
+/**
+ * @brief a layer whose nodes are the pixels of an image, all connected to a
+ *   square patch of the image of the previous layer with the same weights
+ *   (a kernel for every pair of input and output channels), and with a bias
+ *   for every output channel. Patches are copied in the rows of a matrix
+ *   (im2col), so that the whole layer is a few matrix multiplications, over
+ *   the pixels of all the samples of a batch at once.
+ * @see Conv2D
+ * @see ConvTranspose2D
+ */
+class Convolution : public Layer {
+public:
+	size_t inputSize() const override {
+		return m_inputShape.size();
+	}
+	size_t outputSize() const override {
+		return m_outputShape.size();
+	}
+
+	const ImageShape& inputShape() const {
+		return m_inputShape;
+	}
+	const ImageShape& outputShape() const {
+		return m_outputShape;
+	}
+
+	size_t activationBytes() const override {
+		return (m_columns.capacity() + m_columnsGradient.capacity()) * sizeof(flt_t);
+	}
+
+protected:
+	/**
+	 * @param inputShape the shape of the image of the previous layer
+	 * @param outputShape the shape of the image of this layer
+	 * @param kernelSize the width and height of the patches
+	 * @param stride the distance between patches
+	 * @param padding the zero pixels around the larger image
+	 * @param weightCount the size of the weight matrix
+	 * @param fanIn how many inputs every output depends on, on average
+	 */
+	Convolution(const ImageShape& inputShape,
+		const ImageShape& outputShape,
+		const size_t kernelSize,
+		const size_t stride,
+		const size_t padding,
+		const size_t weightCount,
+		const size_t fanIn);
+
+	void writeShape(std::ostream& out) const override;
+
+	/**
+	 * @brief copies the patches of an image in the rows of a matrix, one row
+	 *   per pixel of a smaller grid
+	 * @param image the larger image
+	 * @param shape the shape of the larger image
+	 * @param grid the shape of the smaller image, whose channels are ignored
+	 * @param columns where to write grid.width * grid.height rows of
+	 *   kernelSize * kernelSize * shape.channels values
+	 */
+	void im2col(const flt_t* image, const ImageShape& shape, const ImageShape& grid, flt_t* columns) const;
+
+	/**
+	 * @brief the opposite of im2col: adds the rows of a matrix to the patches
+	 *   of an image they come from
+	 */
+	void col2im(const flt_t* columns, const ImageShape& shape, const ImageShape& grid, flt_t* image) const;
+
+	/**
+	 * @return the size of a patch of the larger image
+	 */
+	size_t patchSize(const ImageShape& shape) const {
+		return m_kernelSize * m_kernelSize * shape.channels;
+	}
+
+	/**
+	 * @return the buffer of the im2col matrix of the inputs, shared with the
+	 *   other layers when they are recomputed
+	 */
+	AlignedVector<flt_t>& columns();
+
+	/**
+	 * @return the buffer of the im2col matrix of the errors, shared with the
+	 *   other layers when they are recomputed
+	 */
+	AlignedVector<flt_t>& columnsGradient();
+
+	/**
+	 * @brief adds the biases to every pixel of a batch of output images
+	 */
+	void addBiases(flt_t* z, const size_t batchSize) const;
+
+	/**
+	 * @brief accumulates the gradients of the biases from the errors of a batch
+	 */
+	void accumulateBiasesGradient(const flt_t* errors, const size_t batchSize);
+
+	ImageShape m_inputShape, m_outputShape;
+	size_t m_kernelSize, m_stride, m_padding;
+
+	AlignedVector<flt_t> m_columns, m_columnsGradient; // im2col matrices, reused across batches
+};
+
+/**
+ * @brief convolution whose output is smaller than (or as large as) its input:
+ *   every output pixel is computed from a patch of the input
+ */
+class Conv2D : public Convolution {
+public:
+	/**
+	 * @param inputShape the shape of the image of the previous layer
+	 * @param outputChannels the number of kernels
+	 * @param kernelSize the width and height of the patches
+	 * @param stride the distance between patches
+	 * @param padding the zero pixels around the input
+	 */
+	Conv2D(const ImageShape& inputShape,
+		const size_t outputChannels,
+		const size_t kernelSize,
+		const size_t stride = 1,
+		const size_t padding = 0);
+
+	std::unique_ptr<Layer> clone() const override;
+	const char* name() const override {
+		return "conv2d";
+	}
+	void forward(const flt_t* inputs, flt_t* z, const size_t batchSize) override;
+	void infer(const flt_t* inputs, flt_t* z, const size_t batchSize) const override;
+	void backward(const flt_t* inputs, const flt_t* errors, flt_t* inputErrors, const size_t batchSize) override;
+	size_t multiplyAdds() const override;
+
+private:
+	/**
+	 * @brief the forward pass, with the im2col matrix of the inputs in columns
+	 */
+	void convolve(const flt_t* inputs, flt_t* z, const size_t batchSize, AlignedVector<flt_t>& columns) const;
+};
+
+/**
+ * @brief the transpose of Conv2D, whose output is larger than its input:
+ *   every input pixel is spread over a patch of the output, e.g. to decode
+ *   images in an autoencoder
+ */
+class ConvTranspose2D : public Convolution {
+public:
+	/**
+	 * @param inputShape the shape of the image of the previous layer
+	 * @param outputChannels the number of channels of the output
+	 * @param kernelSize the width and height of the patches
+	 * @param stride the distance between patches
+	 * @param padding the pixels removed around the output
+	 */
+	ConvTranspose2D(const ImageShape& inputShape,
+		const size_t outputChannels,
+		const size_t kernelSize,
+		const size_t stride = 1,
+		const size_t padding = 0);
+
+	std::unique_ptr<Layer> clone() const override;
+	const char* name() const override {
+		return "convtranspose2d";
+	}
+	void forward(const flt_t* inputs, flt_t* z, const size_t batchSize) override;
+	void infer(const flt_t* inputs, flt_t* z, const size_t batchSize) const override;
+	void backward(const flt_t* inputs, const flt_t* errors, flt_t* inputErrors, const size_t batchSize) override;
+	size_t multiplyAdds() const override;
+
+private:
+	/**
+	 * @brief the forward pass, with the rows added to the output in columns
+	 */
+	void convolve(const flt_t* inputs, flt_t* z, const size_t batchSize, AlignedVector<flt_t>& columns) const;
+};
+
+} // namespace nn
+
+#endif // _NN_CONVOLUTION_HPP_
@@ -3,6 +3,7 @@
 
 #include "utils.hpp"
 #include "ActivationFunction.hpp"
+#include <limits>
 
 namespace nn {
 
@@ -17,6 +18,15 @@ class CostFunction {
 public:
 	virtual flt_t operator()(const flt_t a, const flt_t y) const = 0;
 	virtual flt_t derivative(const flt_t z, const flt_t a, const flt_t y, const ActivationFunction& f) const = 0;
+
+	/**
+	 * @brief whether the derivative is just `a - y` for output nodes with
+	 *   activation function f, so that the error of the output layer can be
+	 *   calculated without calling it for every node
+	 */
+	virtual bool isDifference(const ActivationFunction&) const {
+		return false;
+	}
 };
 
 class QuadraticCost : public CostFunction {
@@ -42,9 +52,32 @@ public:
 	flt_t derivative(const flt_t, const flt_t a, const flt_t y, const ActivationFunction&) const final {
 		return a-y;
 	}
+	bool isDifference(const ActivationFunction& f) const final {
+		return f.isElementwise();
+	}
 };
 inline CrossEntropyCost crossEntropyCost;
 
+// Cross entropy between the expected class and the probabilities of a Softmax output layer:
+// summed over the outputs it is -log(a) of the expected class. Together with Softmax the
+// derivative with respect to z is just a-y, so the Jacobian of Softmax is never needed.
+// With elementwise output functions (e.g. sigmoid) it is the derivative of -y*log(a) alone.
+class CategoricalCrossEntropyCost : public CostFunction {
+public:
+	flt_t operator()(const flt_t a, const flt_t y) const final {
+		if (y == 0) return 0.0;
+		return - y*std::log(std::max(a, std::numeric_limits<flt_t>::min())); // prevent log(0)
+	}
+	flt_t derivative(const flt_t z, const flt_t a, const flt_t y, const ActivationFunction& f) const final {
+		if (y == 0) return 0.0;
+		return - y * f.derivative(z) / std::max(a, std::numeric_limits<flt_t>::min()); // prevent division by 0
+	}
+	bool isDifference(const ActivationFunction& f) const final {
+		return !f.isElementwise();
+	}
+};
+inline CategoricalCrossEntropyCost categoricalCrossEntropyCost;
+
 } // namespace nn
 
 #endif // _NN_COSTFUNCTION_HPP_
\ No newline at end of file
@@ -0,0 +1,338 @@
+#include "Dense.hpp"
+#include "Optimizer.hpp"
+#include "Gemm.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace nn {
+
+namespace {
+	// with lazy weight decay, the stored weights grow as the scale of their
+	// layer decays: it is folded into them before they lose precision
+	constexpr flt_t minWeightScale = 1e-3;
+}
+
+DenseLayer::DenseLayer(const size_t inputSize, const size_t outputSize) :
+		Layer{outputSize * paddedSize(inputSize), outputSize, inputSize},
+		m_inputSize{inputSize}, m_stride{paddedSize(inputSize)}, m_weightsMask{},
+		m_lazyWeightDecay{false}, m_weightScale{1}, m_catchUpRatio{0},
+		m_step{0}, m_inputSteps{}, m_touchedInputs{}, m_denseBatch{false} {}
+
+std::unique_ptr<Layer> DenseLayer::clone() const {
+	return std::make_unique<DenseLayer>(*this);
+}
+
+void DenseLayer::initialize() {
+	const flt_t standardDeviation = 1.0 / std::sqrt(m_inputSize);
+	for(size_t y = 0; y != m_biases.size(); ++y) {
+		m_biases[y] = random(1);
+		flt_t* weights = row(y);
+		for(size_t yFrom = 0; yFrom != m_inputSize; ++yFrom) {
+			weights[yFrom] = random(standardDeviation);
+		}
+	}
+}
+
+void DenseLayer::forward(const flt_t* inputs, flt_t* z, const size_t batchSize) {
+	if (!m_inputSteps.empty())
+		catchUpInputs();
+	// a single sample is padded, which adds 0
+	if (batchSize == 1)
+		forwardSample(assumeAligned(inputs), z, m_stride);
+	else
+		infer(inputs, z, batchSize);
+}
+
+void DenseLayer::infer(const flt_t* inputs, flt_t* z, const size_t batchSize) const {
+	const size_t outputs = m_biases.size();
+	if (batchSize == 1) {
+		forwardSample(inputs, z, m_inputSize);
+		return;
+	}
+
+	// z (samples x outputs) = inputs (samples x inputs) * weightsᵀ (inputs x outputs),
+	// which reads every weight once for all the samples
+	for(size_t b = 0; b != batchSize; ++b) {
+		if (m_lazyWeightDecay)
+			std::fill(z + b * outputs, z + (b+1) * outputs, (flt_t)0);
+		else
+			std::copy(m_biases.begin(), m_biases.end(), z + b * outputs);
+	}
+	gemm(false, true, batchSize, outputs, m_inputSize, 1, inputs, m_inputSize,
+		m_weights.data(), m_stride, 1, z, outputs);
+	if (m_lazyWeightDecay) {
+		for(size_t b = 0; b != batchSize; ++b) {
+			for(size_t y = 0; y != outputs; ++y)
+				z[b * outputs + y] = m_biases[y] + m_weightScale * z[b * outputs + y];
+		}
+	}
+}
+
+void DenseLayer::forwardSample(const flt_t* inputs, flt_t* z, const size_t length) const {
+	for(size_t y = 0; y != m_biases.size(); ++y) {
+		flt_t sum = m_lazyWeightDecay ? 0 : m_biases[y];
+		const flt_t* weights = assumeAligned(row(y));
+		for(size_t yFrom = 0; yFrom != length; ++yFrom) {
+			sum += inputs[yFrom] * weights[yFrom];
+		}
+		z[y] = m_lazyWeightDecay ? m_biases[y] + m_weightScale * sum : sum;
+	}
+}
+
+void DenseLayer::forwardSparse(const flt_t* inputs, const std::vector<uint32_t>& activeInputs, flt_t* z) {
+	if (!m_inputSteps.empty()) {
+		for(auto&& yFrom : activeInputs)
+			catchUpInput(yFrom);
+	}
+	for(size_t y = 0; y != m_biases.size(); ++y) {
+		flt_t sum = m_lazyWeightDecay ? 0 : m_biases[y];
+		const flt_t* weights = row(y);
+		for(auto&& yFrom : activeInputs) {
+			sum += inputs[yFrom] * weights[yFrom];
+		}
+		z[y] = m_lazyWeightDecay ? m_biases[y] + m_weightScale * sum : sum;
+	}
+}
+
+void DenseLayer::backward(const flt_t* inputs, const flt_t* errors, flt_t* inputErrors, const size_t batchSize) {
+	m_denseBatch = true;
+	const size_t outputs = m_biases.size();
+	// a single sample is padded: its gradients and input errors need no tail loop
+	const size_t length = batchSize == 1 ? m_stride : m_inputSize;
+	for(size_t b = 0; b != batchSize; ++b) {
+		const flt_t* sampleInputs = inputs + b * m_inputSize;
+		const flt_t* sampleErrors = errors + b * outputs;
+		for(size_t y = 0; y != outputs; ++y) {
+			const flt_t error = sampleErrors[y];
+			m_biasesGradient[y] += error;
+			flt_t* gradient = assumeAligned(m_weightsGradient.data() + y * m_stride);
+			for(size_t yFrom = 0; yFrom != length; ++yFrom) {
+				gradient[yFrom] += error * sampleInputs[yFrom];
+			}
+		}
+
+		if (inputErrors == nullptr)
+			continue;
+		// with lazy weight decay the real weights are the scaled stored ones
+		flt_t* sampleInputErrors = inputErrors + b * m_inputSize;
+		std::fill(sampleInputErrors, sampleInputErrors + length, (flt_t)0);
+		for(size_t y = 0; y != outputs; ++y) {
+			const flt_t error = sampleErrors[y] * m_weightScale;
+			const flt_t* weights = assumeAligned(row(y));
+			for(size_t yFrom = 0; yFrom != length; ++yFrom) {
+				sampleInputErrors[yFrom] += weights[yFrom] * error;
+			}
+		}
+	}
+}
+
+void DenseLayer::backwardSparse(const flt_t* inputs, const std::vector<uint32_t>& activeInputs, const flt_t* errors) {
+	if (m_lazyWeightDecay)
+		m_touchedInputs.insert(m_touchedInputs.end(), activeInputs.begin(), activeInputs.end());
+	for(size_t y = 0; y != m_biases.size(); ++y) {
+		m_biasesGradient[y] += errors[y];
+		// the gradient of the weights of zero inputs is 0
+		flt_t* gradient = m_weightsGradient.data() + y * m_stride;
+		for(auto&& yFrom : activeInputs) {
+			gradient[yFrom] += errors[y] * inputs[yFrom];
+		}
+	}
+}
+
+void DenseLayer::update(const flt_t etaScaled, const flt_t weightDecayFactor, const flt_t momentumCoefficient) {
+	momentumUpdate(m_biases.size(), etaScaled, 1, momentumCoefficient,
+		m_biases.data(), m_biasesVelocity.data(), m_biasesGradient.data());
+
+	// with lazy weight decay the stored weights are divided by the scale,
+	// and so are their velocities, whose steps are then larger
+	flt_t weightsEta = etaScaled, weightsDecay = weightDecayFactor, weightsMomentum = momentumCoefficient;
+	if (m_lazyWeightDecay) {
+		m_weightScale *= weightDecayFactor;
+		weightsEta = etaScaled / m_weightScale;
+		weightsDecay = 1;
+		weightsMomentum = m_catchUpRatio;
+	}
+	const bool sparse = m_lazyWeightDecay && !m_denseBatch;
+	if (sparse) {
+		std::sort(m_touchedInputs.begin(), m_touchedInputs.end());
+		m_touchedInputs.erase(std::unique(m_touchedInputs.begin(), m_touchedInputs.end()), m_touchedInputs.end());
+	}
+	for(size_t y = 0; y != m_biases.size(); ++y) {
+		flt_t* weights = row(y);
+		flt_t* velocities = m_weightsVelocity.data() + y * m_stride;
+		flt_t* gradients = m_weightsGradient.data() + y * m_stride;
+		// pruned weights stay 0 while the others are fine-tuned
+		const flt_t* mask = m_weightsMask.empty() ? nullptr : m_weightsMask.data() + y * m_stride;
+		if (sparse)
+			momentumUpdate(m_touchedInputs, weightsEta, weightsDecay, weightsMomentum, weights, velocities, gradients, mask);
+		else
+			momentumUpdate(m_stride, weightsEta, weightsDecay, weightsMomentum, weights, velocities, gradients, mask);
+	}
+	if (!m_lazyWeightDecay)
+		return;
+	if (m_weightScale < minWeightScale)
+		renormalizeWeights();
+
+	// the inputs of the mini batch were caught up by forward
+	if (sparse) {
+		if (m_inputSteps.empty())
+			m_inputSteps.assign(m_inputSize, m_step);
+		++m_step;
+		for(auto&& yFrom : m_touchedInputs)
+			m_inputSteps[yFrom] = m_step;
+	} else {
+		++m_step;
+		m_inputSteps.clear();
+	}
+	m_touchedInputs.clear();
+	m_denseBatch = false;
+}
+
+void DenseLayer::startLazyWeightDecay(const flt_t weightDecayFactor, const flt_t momentumCoefficient) {
+	// the velocities are 0 at the start of the epoch: the stored ones are the real ones
+	m_lazyWeightDecay = true;
+	m_weightScale = 1;
+	m_catchUpRatio = momentumCoefficient / weightDecayFactor;
+	m_step = 0;
+	m_inputSteps.clear();
+	m_touchedInputs.clear();
+	m_denseBatch = false;
+}
+
+void DenseLayer::foldWeightDecay() {
+	catchUpInputs();
+	renormalizeWeights();
+}
+
+void DenseLayer::stopLazyWeightDecay() {
+	foldWeightDecay();
+	m_lazyWeightDecay = false;
+	m_touchedInputs.clear();
+	m_denseBatch = false;
+}
+
+void DenseLayer::catchUpInputs() {
+	for(size_t yFrom = 0; yFrom != m_inputSteps.size(); ++yFrom)
+		catchUpInput(yFrom);
+	m_inputSteps.clear();
+}
+
+void DenseLayer::catchUpInput(const size_t input) {
+	const size_t missed = m_step - m_inputSteps[input];
+	if (missed == 0)
+		return;
+	m_inputSteps[input] = m_step;
+
+	// with a zero gradient every mini batch multiplies the (stored) velocity
+	// by r = momentum / decay and adds it to the weight: after k of them the
+	// velocity is r^k times it, and the weight gained r + r^2 + ... + r^k times it
+	const double r = m_catchUpRatio;
+	const double rk = std::pow(r, (double)missed);
+	const flt_t velocityFactor = rk;
+	const flt_t weightFactor = r == 1 ? (double)missed : r * (1 - rk) / (1 - r);
+	for(size_t y = 0; y != m_biases.size(); ++y) {
+		const size_t i = y * m_stride + input;
+		m_weights[i] += weightFactor * m_weightsVelocity[i];
+		m_weightsVelocity[i] *= velocityFactor;
+		if (!m_weightsMask.empty())
+			m_weights[i] *= m_weightsMask[i];
+	}
+}
+
+void DenseLayer::renormalizeWeights() {
+	if (m_weightScale == 1)
+		return;
+	// the missed mini batches are linear in the weight and the velocity:
+	// inputs that did not catch up yet can still do so afterwards
+	for(auto&& weight : m_weights)
+		weight *= m_weightScale;
+	for(auto&& velocity : m_weightsVelocity)
+		velocity *= m_weightScale;
+	m_weightScale = 1;
+}
+
+void DenseLayer::pruneByMagnitude(const flt_t sparsity) {
+	std::vector<size_t> weights;
+	for(size_t y = 0; y != m_biases.size(); ++y) {
+		for(size_t yFrom = 0; yFrom != m_inputSize; ++yFrom) {
+			weights.push_back(y * m_stride + yFrom);
+		}
+	}
+	pruneSmallest(weights, std::llround(sparsity * weights.size()));
+}
+
+void DenseLayer::pruneTopK(const size_t k) {
+	if (m_inputSize <= k)
+		return;
+	std::vector<size_t> weights;
+	for(size_t y = 0; y != m_biases.size(); ++y) {
+		weights.clear();
+		for(size_t yFrom = 0; yFrom != m_inputSize; ++yFrom) {
+			weights.push_back(y * m_stride + yFrom);
+		}
+		pruneSmallest(weights, m_inputSize - k);
+	}
+}
+
+void DenseLayer::pruneSmallest(std::vector<size_t>& weights, const size_t count) {
+	if (count == 0)
+		return;
+	std::nth_element(weights.begin(), weights.begin() + (count - 1), weights.end(),
+		[this](const size_t l, const size_t r) {
+			return std::abs(m_weights[l]) < std::abs(m_weights[r]);
+		});
+	if (m_weightsMask.empty()) {
+		m_weightsMask.assign(m_weights.size(), 0);
+		for(size_t y = 0; y != m_biases.size(); ++y)
+			std::fill_n(m_weightsMask.begin() + y * m_stride, m_inputSize, (flt_t)1);
+	}
+	for(size_t i = 0; i != count; ++i) {
+		m_weightsMask[weights[i]] = 0;
+		m_weights[weights[i]] = 0;
+		m_weightsVelocity[weights[i]] = 0;
+	}
+}
+
+void DenseLayer::clearPruningMask() {
+	m_weightsMask.clear();
+}
+
+size_t DenseLayer::prunedWeightCount() const {
+	if (m_weightsMask.empty())
+		return 0;
+	size_t count = 0;
+	for(size_t y = 0; y != m_biases.size(); ++y) {
+		const auto first = m_weightsMask.begin() + y * m_stride;
+		count += std::count(first, first + m_inputSize, 0);
+	}
+	return count;
+}
+
+void DenseLayer::writeParameters(std::ostream& out) const {
+	for(size_t y = 0; y != m_biases.size(); ++y) {
+		out << m_biases[y] << " " << m_inputSize << " ";
+		const flt_t* weights = row(y);
+		for(size_t yFrom = 0; yFrom != m_inputSize; ++yFrom) {
+			out << weights[yFrom] << " ";
+		}
+	}
+}
+
+void DenseLayer::readParameters(std::istream& in) {
+	for(size_t y = 0; y != m_biases.size(); ++y) {
+		size_t weightsSize;
+		in >> m_biases[y] >> weightsSize;
+		if (!in || weightsSize != m_inputSize)
+			throw std::runtime_error{"Expected " + std::to_string(m_inputSize)
+				+ " weights for every node of a dense layer"};
+		flt_t* weights = row(y);
+		for(size_t yFrom = 0; yFrom != m_inputSize; ++yFrom) {
+			in >> weights[yFrom];
+		}
+	}
+}
+
+} /* namespace nn */
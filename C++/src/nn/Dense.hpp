@@ -0,0 +1,177 @@
+#ifndef _NN_DENSE_HPP_
+#define _NN_DENSE_HPP_
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include "utils.hpp"
+#include "Aligned.hpp"
+#include "Layer.hpp"
+
+namespace nn {
+
+/**
+ * @brief a fully-connected layer: every output is the weighted sum of all the
+ *   inputs plus its bias. The weights of every output are a row, padded with
+ *   zeros to a multiple of simdWidth (@see paddedSize) like their gradients,
+ *   velocities and pruning mask, so that the updates need no tail loop.
+ *   Unlike other layers it also skips the zero inputs of sparse samples,
+ *   prunes single weights, and decays its weights lazily.
+ * @see Network::setLazyWeightDecay
+ */
+class DenseLayer : public Layer {
+public:
+	/**
+	 * @param inputSize the size of the previous layer
+	 * @param outputSize the size of this layer
+	 */
+	DenseLayer(const size_t inputSize, const size_t outputSize);
+
+	std::unique_ptr<Layer> clone() const override;
+
+	const char* name() const override {
+		return "dense";
+	}
+	size_t inputSize() const override {
+		return m_inputSize;
+	}
+	size_t outputSize() const override {
+		return m_biases.size();
+	}
+	size_t multiplyAdds() const override {
+		return m_inputSize * m_biases.size();
+	}
+	size_t weightCount() const override {
+		return m_inputSize * m_biases.size();
+	}
+
+	/**
+	 * @brief the distance between the rows of weights of two outputs
+	 */
+	size_t stride() const {
+		return m_stride;
+	}
+	flt_t* row(const size_t output) {
+		return m_weights.data() + output * m_stride;
+	}
+	const flt_t* row(const size_t output) const {
+		return m_weights.data() + output * m_stride;
+	}
+
+	/**
+	 * @brief draws the bias and then the weights of every output in turn
+	 */
+	void initialize() override;
+
+	void forward(const flt_t* inputs, flt_t* z, const size_t batchSize) override;
+	void infer(const flt_t* inputs, flt_t* z, const size_t batchSize) const override;
+	void backward(const flt_t* inputs, const flt_t* errors, flt_t* inputErrors, const size_t batchSize) override;
+
+	/**
+	 * @brief only multiplies the weights of the active inputs
+	 */
+	void forwardSparse(const flt_t* inputs, const std::vector<uint32_t>& activeInputs, flt_t* z) override;
+
+	/**
+	 * @brief only accumulates the gradients of the weights of the active
+	 *   inputs, which are the only nonzero ones; with lazy weight decay, if no
+	 *   sample of the mini batch is dense, update then only updates those weights
+	 */
+	void backwardSparse(const flt_t* inputs, const std::vector<uint32_t>& activeInputs, const flt_t* errors) override;
+
+	void update(const flt_t etaScaled, const flt_t weightDecayFactor, const flt_t momentumCoefficient) override;
+
+	void startLazyWeightDecay(const flt_t weightDecayFactor, const flt_t momentumCoefficient) override;
+	void foldWeightDecay() override;
+	void stopLazyWeightDecay() override;
+
+	/**
+	 * @brief prunes the weights with the smallest magnitude
+	 * @param sparsity the fraction of the weights to prune, in [0, 1]
+	 * @see Network::pruneByMagnitude
+	 */
+	void pruneByMagnitude(const flt_t sparsity);
+
+	/**
+	 * @brief keeps only the k weights with the largest magnitude of every output
+	 * @see Network::pruneTopK
+	 */
+	void pruneTopK(const size_t k);
+
+	void clearPruningMask();
+
+	size_t prunedWeightCount() const;
+
+protected:
+	/**
+	 * @brief writes nothing: the sizes of the layer are those of the network
+	 */
+	void writeShape(std::ostream& out) const override {
+		(void)out;
+	}
+
+	/**
+	 * @brief writes every output as its bias, the number of its weights and
+	 *   the weights, the format of the fully-connected layers of older versions
+	 */
+	void writeParameters(std::ostream& out) const override;
+	void readParameters(std::istream& in) override;
+
+private:
+	/**
+	 * @brief prunes exactly count weights, the ones with the smallest magnitude
+	 * @param weights the index of every candidate weight
+	 * @param count how many of them to prune
+	 */
+	void pruneSmallest(std::vector<size_t>& weights, const size_t count);
+
+	/**
+	 * @brief calculates the weighted sums of a single sample
+	 * @param length how many inputs to multiply: m_stride if they are padded
+	 *   with zeros, which saves the tail loop
+	 */
+	void forwardSample(const flt_t* inputs, flt_t* z, const size_t length) const;
+
+	/**
+	 * @brief applies to the weights of an input the mini batches they missed,
+	 *   in which their gradient was 0
+	 */
+	void catchUpInput(const size_t input);
+
+	/**
+	 * @brief applies the missed mini batches to the weights of all inputs
+	 */
+	void catchUpInputs();
+
+	/**
+	 * @brief multiplies the weights and the velocities by the scale, which becomes 1
+	 */
+	void renormalizeWeights();
+
+	size_t m_inputSize;
+	size_t m_stride;
+
+	// 1 for kept weights and 0 for pruned ones and the padding, empty if the
+	// layer was never pruned
+	AlignedVector<flt_t> m_weightsMask;
+
+	// during an epoch with lazy weight decay the weights and the velocities
+	// are m_weightScale times the stored ones
+	bool m_lazyWeightDecay;
+	flt_t m_weightScale;
+	flt_t m_catchUpRatio; // momentumCoefficient / weightDecayFactor
+	// the mini batches of the epoch, and how many of them the weights of every
+	// input received: sparse mini batches only update the weights of their
+	// nonzero inputs, the others catch up when they are used. Empty when all
+	// of them are up to date.
+	size_t m_step;
+	std::vector<size_t> m_inputSteps;
+	std::vector<uint32_t> m_touchedInputs; // nonzero inputs of the mini batch
+	bool m_denseBatch; // whether the mini batch had a dense sample
+};
+
+} // namespace nn
+
+#endif // _NN_DENSE_HPP_
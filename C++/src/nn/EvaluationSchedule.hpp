@@ -0,0 +1,48 @@
+#ifndef _NN_EVALUATIONSCHEDULE_HPP_
+#define _NN_EVALUATIONSCHEDULE_HPP_
+
+#include "utils.hpp"
+
+namespace nn {
+
+/**
+ * @brief when and how precisely momentumSGD evaluates the network on the test
+ *   samples. The default evaluates accuracy and cost on all test samples
+ *   before training and after every epoch.
+ */
+struct EvaluationSchedule {
+	bool beforeTraining = true;
+
+	// evaluate after every `everyEpochs` epochs and after the last one;
+	// 0 to never evaluate at the end of epochs
+	size_t everyEpochs = 1;
+
+	// evaluate also in the middle of epochs, every `everyMiniBatches` mini
+	// batches; 0 to never evaluate in the middle of epochs
+	size_t everyMiniBatches = 0;
+
+	// evaluate on a random subset of this many test samples (drawn again at
+	// every evaluation) and report a confidence interval for the accuracy;
+	// 0 to evaluate on all test samples. Drawing from a SampleSource reads a
+	// whole pass of it.
+	size_t subsetSize = 0;
+
+	// the confidence level of the reported accuracy interval
+	double confidence = 0.95;
+
+	// whether to calculate also the cost, which needs another pass over the samples
+	bool computeCost = true;
+
+	unsigned int seed = 0; // for drawing the subsets
+
+	// evaluate on a snapshot of the weights in a background thread while
+	// training continues; results are reported on the training thread after
+	// they are ready, i.e. during the following mini batches, and at most one
+	// evaluation runs at a time. Test samples from a SampleSource must not be
+	// shared with training. Evaluation time is then not profiled.
+	bool background = false;
+};
+
+} // namespace nn
+
+#endif // _NN_EVALUATIONSCHEDULE_HPP_
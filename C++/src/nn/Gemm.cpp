@@ -0,0 +1,126 @@
+#include "Gemm.hpp"
+#include "Aligned.hpp"
+
+#include <vector>
+#include <algorithm>
+
+namespace nn {
+
+namespace {
+	// a block of b of blockK x blockN floats takes 256 KiB, about the size of L2
+	constexpr size_t blockK = 128, blockN = 512;
+	// the columns of c kept in registers while they accumulate a block of
+	// products: four rows of them take sixteen 16-byte vectors
+	constexpr size_t panelWidth = 16;
+
+	/**
+	 * @brief c[i][j] += a[i][p] * b[p][j] for a block of b, four rows of c at a
+	 *   time, panelWidth columns of which accumulate in registers instead of
+	 *   being loaded and stored for every p; the sums are in the same order
+	 * @param a element (i, p) is at a[i*aRow + p*aColumn], already scaled by alpha
+	 */
+	void multiplyBlock(const size_t m, const size_t n, const size_t k,
+			const flt_t alpha, const flt_t* a, const size_t aRow, const size_t aColumn,
+			const flt_t* b, const size_t ldb,
+			flt_t* c, const size_t ldc) {
+		size_t i = 0;
+		for(; i + 4 <= m; i += 4) {
+			flt_t* c0 = c + i*ldc;
+			flt_t* c1 = c0 + ldc;
+			flt_t* c2 = c1 + ldc;
+			flt_t* c3 = c2 + ldc;
+			size_t j0 = 0;
+			for(; j0 + panelWidth <= n; j0 += panelWidth) {
+				flt_t s0[panelWidth], s1[panelWidth], s2[panelWidth], s3[panelWidth];
+				for(size_t j = 0; j != panelWidth; ++j) {
+					s0[j] = c0[j0 + j];
+					s1[j] = c1[j0 + j];
+					s2[j] = c2[j0 + j];
+					s3[j] = c3[j0 + j];
+				}
+				for(size_t p = 0; p != k; ++p) {
+					const flt_t a0 = alpha * a[i*aRow + p*aColumn];
+					const flt_t a1 = alpha * a[(i+1)*aRow + p*aColumn];
+					const flt_t a2 = alpha * a[(i+2)*aRow + p*aColumn];
+					const flt_t a3 = alpha * a[(i+3)*aRow + p*aColumn];
+					const flt_t* bp = b + p*ldb + j0;
+					for(size_t j = 0; j != panelWidth; ++j) {
+						s0[j] += a0 * bp[j];
+						s1[j] += a1 * bp[j];
+						s2[j] += a2 * bp[j];
+						s3[j] += a3 * bp[j];
+					}
+				}
+				for(size_t j = 0; j != panelWidth; ++j) {
+					c0[j0 + j] = s0[j];
+					c1[j0 + j] = s1[j];
+					c2[j0 + j] = s2[j];
+					c3[j0 + j] = s3[j];
+				}
+			}
+			for(size_t p = 0; p != k; ++p) {
+				const flt_t a0 = alpha * a[i*aRow + p*aColumn];
+				const flt_t a1 = alpha * a[(i+1)*aRow + p*aColumn];
+				const flt_t a2 = alpha * a[(i+2)*aRow + p*aColumn];
+				const flt_t a3 = alpha * a[(i+3)*aRow + p*aColumn];
+				const flt_t* bp = b + p*ldb;
+				for(size_t j = j0; j != n; ++j) {
+					c0[j] += a0 * bp[j];
+					c1[j] += a1 * bp[j];
+					c2[j] += a2 * bp[j];
+					c3[j] += a3 * bp[j];
+				}
+			}
+		}
+		for(; i != m; ++i) {
+			flt_t* ci = c + i*ldc;
+			for(size_t p = 0; p != k; ++p) {
+				const flt_t aip = alpha * a[i*aRow + p*aColumn];
+				const flt_t* bp = b + p*ldb;
+				for(size_t j = 0; j != n; ++j) {
+					ci[j] += aip * bp[j];
+				}
+			}
+		}
+	}
+}
+
+void gemm(const bool transposeA, const bool transposeB,
+		const size_t m, const size_t n, const size_t k,
+		const flt_t alpha, const flt_t* a, const size_t lda,
+		const flt_t* b, const size_t ldb,
+		const flt_t beta, flt_t* c, const size_t ldc) {
+	for(size_t i = 0; i != m; ++i) {
+		flt_t* ci = c + i*ldc;
+		if (beta == 0)
+			std::fill(ci, ci + n, (flt_t)0);
+		else if (beta != 1)
+			for(size_t j = 0; j != n; ++j)
+				ci[j] *= beta;
+	}
+
+	const size_t aRow = transposeA ? 1 : lda, aColumn = transposeA ? lda : 1;
+	// a transposed b is copied block by block, so that its rows are contiguous
+	// too, in a buffer kept by the thread so that inference does not allocate
+	thread_local AlignedVector<flt_t> packed;
+	if (transposeB)
+		packed.resize(blockK * blockN);
+	for(size_t k0 = 0; k0 < k; k0 += blockK) {
+		const size_t kSize = std::min(blockK, k - k0);
+		for(size_t n0 = 0; n0 < n; n0 += blockN) {
+			const size_t nSize = std::min(blockN, n - n0);
+			if (transposeB) {
+				for(size_t j = 0; j != nSize; ++j)
+					for(size_t p = 0; p != kSize; ++p)
+						packed[p*blockN + j] = b[(n0 + j)*ldb + k0 + p];
+				multiplyBlock(m, nSize, kSize, alpha, a + k0*aColumn, aRow, aColumn,
+					packed.data(), blockN, c + n0, ldc);
+			} else {
+				multiplyBlock(m, nSize, kSize, alpha, a + k0*aColumn, aRow, aColumn,
+					b + k0*ldb + n0, ldb, c + n0, ldc);
+			}
+		}
+	}
+}
+
+} /* namespace nn */
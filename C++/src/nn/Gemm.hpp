@@ -0,0 +1,37 @@
+#ifndef _NN_GEMM_HPP_
+#define _NN_GEMM_HPP_
+
+#include <cstddef>
+#include "utils.hpp"
+
+namespace nn {
+
+/**
+ * @brief general matrix multiplication of row-major matrices:
+ *   c = alpha * op(a) * op(b) + beta * c, where op transposes its matrix if
+ *   requested. It works on blocks of b that stay in cache, and four rows of c
+ *   at a time, with inner loops over contiguous memory without reductions,
+ *   which the compiler vectorizes.
+ * @param transposeA whether a is stored k x m instead of m x k
+ * @param transposeB whether b is stored n x k instead of k x n
+ * @param m the rows of op(a) and of c
+ * @param n the columns of op(b) and of c
+ * @param k the columns of op(a) and the rows of op(b)
+ * @param alpha scales the product
+ * @param a the first matrix
+ * @param lda the distance between the rows of a, as stored
+ * @param b the second matrix
+ * @param ldb the distance between the rows of b, as stored
+ * @param beta scales c before adding the product; if 0, c is only written
+ * @param c the result
+ * @param ldc the distance between the rows of c
+ */
+void gemm(const bool transposeA, const bool transposeB,
+	const size_t m, const size_t n, const size_t k,
+	const flt_t alpha, const flt_t* a, const size_t lda,
+	const flt_t* b, const size_t ldb,
+	const flt_t beta, flt_t* c, const size_t ldc);
+
+} // namespace nn
+
+#endif // _NN_GEMM_HPP_
@@ -0,0 +1,128 @@
+#include "Layer.hpp"
+#include "Dense.hpp"
+#include "Convolution.hpp"
+#include "Pooling.hpp"
+#include "Optimizer.hpp"
+
+#include <array>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+namespace nn {
+
+namespace {
+	thread_local std::array<AlignedVector<flt_t>, 2> sharedBuffers;
+}
+
+Layer::Layer(const size_t weightCount, const size_t biasCount, const size_t fanIn) :
+		m_fanIn{fanIn}, m_recomputation{false},
+		m_weights(weightCount), m_biases(biasCount),
+		m_weightsGradient(weightCount), m_biasesGradient(biasCount),
+		m_weightsVelocity(weightCount), m_biasesVelocity(biasCount) {}
+
+void Layer::initialize() {
+	const flt_t standardDeviation = 1.0 / std::sqrt(std::max<size_t>(1, m_fanIn));
+	for(auto&& weight : m_weights)
+		weight = random(standardDeviation);
+	for(auto&& bias : m_biases)
+		bias = random(1);
+}
+
+void Layer::setParameters(const Layer& other) {
+	if (other.m_weights.size() != m_weights.size() || other.m_biases.size() != m_biases.size())
+		throw std::runtime_error{std::string{"Copying the parameters of a "} + other.name()
+			+ " layer to a " + name() + " layer with a different shape"};
+	std::copy(other.m_weights.begin(), other.m_weights.end(), m_weights.begin());
+	std::copy(other.m_biases.begin(), other.m_biases.end(), m_biases.begin());
+}
+
+void Layer::resetGradients() {
+	std::fill(m_weightsGradient.begin(), m_weightsGradient.end(), (flt_t)0);
+	std::fill(m_biasesGradient.begin(), m_biasesGradient.end(), (flt_t)0);
+}
+
+void Layer::resetVelocities() {
+	std::fill(m_weightsVelocity.begin(), m_weightsVelocity.end(), (flt_t)0);
+	std::fill(m_biasesVelocity.begin(), m_biasesVelocity.end(), (flt_t)0);
+}
+
+void Layer::update(const flt_t etaScaled, const flt_t weightDecayFactor, const flt_t momentumCoefficient) {
+	momentumUpdate(m_biases.size(), etaScaled, 1, momentumCoefficient,
+		m_biases.data(), m_biasesVelocity.data(), m_biasesGradient.data());
+	momentumUpdate(m_weights.size(), etaScaled, weightDecayFactor, momentumCoefficient,
+		m_weights.data(), m_weightsVelocity.data(), m_weightsGradient.data());
+}
+
+flt_t Layer::squaredWeightSum() const {
+	flt_t sum = 0;
+	for(auto&& weight : m_weights)
+		sum += weight * weight;
+	return sum;
+}
+
+size_t Layer::sharedActivationBytes() {
+	size_t bytes = 0;
+	for(auto&& buffer : sharedBuffers)
+		bytes += buffer.capacity() * sizeof(flt_t);
+	return bytes;
+}
+
+AlignedVector<flt_t>& Layer::sharedBuffer(const size_t index) {
+	return sharedBuffers.at(index);
+}
+
+void Layer::writeParameters(std::ostream& out) const {
+	for(auto&& weight : m_weights)
+		out << weight << " ";
+	for(auto&& bias : m_biases)
+		out << bias << " ";
+}
+
+void Layer::readParameters(std::istream& in) {
+	for(auto&& weight : m_weights)
+		in >> weight;
+	for(auto&& bias : m_biases)
+		in >> bias;
+}
+
+std::ostream& operator<<(std::ostream& out, const Layer& layer) {
+	out << layer.name() << " ";
+	layer.writeShape(out);
+	layer.writeParameters(out);
+	return out;
+}
+
+std::unique_ptr<Layer> readLayer(std::istream& in, const std::string& name,
+		const size_t inputSize, const size_t outputSize) {
+	std::unique_ptr<Layer> layer;
+	ImageShape shape;
+	if (name == "dense") {
+		layer = std::make_unique<DenseLayer>(inputSize, outputSize);
+	} else if (name == "conv2d" || name == "convtranspose2d") {
+		size_t outputChannels, kernelSize, stride, padding;
+		in >> shape.width >> shape.height >> shape.channels >> outputChannels >> kernelSize >> stride >> padding;
+		if (!in)
+			throw std::runtime_error{"Invalid shape of the layer " + name};
+		if (name == "conv2d")
+			layer = std::make_unique<Conv2D>(shape, outputChannels, kernelSize, stride, padding);
+		else
+			layer = std::make_unique<ConvTranspose2D>(shape, outputChannels, kernelSize, stride, padding);
+	} else if (name == "maxpool2d" || name == "averagepool2d") {
+		size_t kernelSize, stride;
+		in >> shape.width >> shape.height >> shape.channels >> kernelSize >> stride;
+		if (!in)
+			throw std::runtime_error{"Invalid shape of the layer " + name};
+		if (name == "maxpool2d")
+			layer = std::make_unique<MaxPool2D>(shape, kernelSize, stride);
+		else
+			layer = std::make_unique<AveragePool2D>(shape, kernelSize, stride);
+	} else {
+		return nullptr;
+	}
+
+	layer->readParameters(in);
+	return layer;
+}
+
+} /* namespace nn */
@@ -0,0 +1,292 @@
+#ifndef _NN_LAYER_HPP_
+#define _NN_LAYER_HPP_
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include "utils.hpp"
+#include "Aligned.hpp"
+
+namespace nn {
+
+/**
+ * @brief the size of the images of a layer, whose values are stored row by row
+ *   with the channels of every pixel next to each other, like the interleaved
+ *   RGB images of stb_image and ImageAugmenter
+ */
+struct ImageShape {
+	size_t width, height, channels;
+
+	size_t size() const {
+		return width * height * channels;
+	}
+};
+
+/**
+ * @brief the computation of a layer of a Network from the activations of the
+ *   previous one, e.g. a fully-connected, a convolution or a pooling layer.
+ *   It keeps the parameters of its layer, whose Nodes only keep z, a and the
+ *   error, while the activation function of the layer is still applied by
+ *   the Network. All methods work on batches of samples stored one after the
+ *   other; the gradients of the parameters are accumulated over the samples
+ *   until they are applied by update, with momentum and weight decay.
+ *   New kinds of layers only need to implement the pure virtual methods and
+ *   to be added to readLayer; the other virtual methods have defaults that
+ *   are correct for every layer, e.g. sparse inputs are processed as dense ones.
+ * @see DenseLayer
+ * @see Conv2D
+ * @see MaxPool2D
+ */
+class Layer {
+public:
+	virtual ~Layer() = default;
+
+	/**
+	 * @return a copy of the layer with its parameters
+	 */
+	virtual std::unique_ptr<Layer> clone() const = 0;
+
+	/**
+	 * @brief the kind of the layer, under which it is saved in model files
+	 * @see readLayer
+	 */
+	virtual const char* name() const = 0;
+
+	/**
+	 * @return the number of values of every sample taken from the previous layer
+	 */
+	virtual size_t inputSize() const = 0;
+
+	/**
+	 * @return the number of values of every sample given to the activation function
+	 */
+	virtual size_t outputSize() const = 0;
+
+	/**
+	 * @brief calculates the weighted sums of the outputs of a batch
+	 * @param inputs the activations of the previous layer, inputSize() per
+	 *   sample; a single sample is padded with zeros to paddedSize(inputSize()),
+	 *   so that dense kernels need no tail loop (@see PaddedVector)
+	 * @param z where to write the weighted sums, outputSize() per sample
+	 * @param batchSize the number of samples
+	 */
+	virtual void forward(const flt_t* inputs, flt_t* z, const size_t batchSize) = 0;
+
+	/**
+	 * @brief accumulates the gradients of the parameters for a batch, and
+	 *   propagates its errors to the inputs. Must follow the forward pass of
+	 *   the same inputs.
+	 * @param inputs the same passed to forward
+	 * @param errors the derivatives of the cost with respect to every z
+	 * @param inputErrors where to write the derivatives of the cost with
+	 *   respect to every input, or nullptr if they are not needed; for a single
+	 *   sample padded like the inputs, and the padding is left at 0
+	 * @param batchSize the number of samples
+	 */
+	virtual void backward(const flt_t* inputs, const flt_t* errors, flt_t* inputErrors, const size_t batchSize) = 0;
+
+	/**
+	 * @brief computes the same weighted sums as forward, but keeps nothing for
+	 *   backward, so that several threads can infer with the layer at once,
+	 *   e.g. in Network::calculateBatch; what it needs to compute them is
+	 *   kept by the thread. The weights must be up to date (@see foldWeightDecay).
+	 *   Unlike those of forward, the inputs of a single sample need no padding.
+	 */
+	virtual void infer(const flt_t* inputs, flt_t* z, const size_t batchSize) const = 0;
+
+	/**
+	 * @brief forward of a single sample of which only some inputs are nonzero,
+	 *   e.g. sparse samples given to the first layer
+	 * @param inputs all the inputs, also the ones that are 0
+	 * @param activeInputs the indices of the nonzero inputs
+	 * @param z where to write the weighted sums
+	 */
+	virtual void forwardSparse(const flt_t* inputs, const std::vector<uint32_t>& activeInputs, flt_t* z) {
+		(void)activeInputs;
+		forward(inputs, z, 1);
+	}
+
+	/**
+	 * @brief backward of a single sample of which only some inputs are
+	 *   nonzero, without propagating the errors to the inputs. Must follow the
+	 *   forwardSparse of the same inputs.
+	 * @see forwardSparse
+	 */
+	virtual void backwardSparse(const flt_t* inputs, const std::vector<uint32_t>& activeInputs, const flt_t* errors) {
+		(void)activeInputs;
+		backward(inputs, errors, nullptr, 1);
+	}
+
+	/**
+	 * @return the multiplications (and additions) of the forward pass of a sample
+	 */
+	virtual size_t multiplyAdds() const = 0;
+
+	/**
+	 * @return the bytes kept by the layer from the forward pass for the
+	 *   backward pass, or reused across batches
+	 */
+	virtual size_t activationBytes() const {
+		return 0;
+	}
+
+	/**
+	 * @brief whether backward recomputes what it needs from its inputs instead
+	 *   of keeping it since forward, in buffers shared by all layers of the
+	 *   thread: it saves memory at the cost of repeating part of the forward pass
+	 */
+	void setRecomputation(const bool enabled) {
+		m_recomputation = enabled;
+	}
+
+	/**
+	 * @return the bytes of the buffers shared by the layers of the calling
+	 *   thread that recompute their activations
+	 * @see setRecomputation
+	 */
+	static size_t sharedActivationBytes();
+
+	/**
+	 * @brief the parameters, on which weight decay applies
+	 */
+	AlignedVector<flt_t>& weights() {
+		return m_weights;
+	}
+	const AlignedVector<flt_t>& weights() const {
+		return m_weights;
+	}
+	AlignedVector<flt_t>& biases() {
+		return m_biases;
+	}
+	const AlignedVector<flt_t>& biases() const {
+		return m_biases;
+	}
+
+	/**
+	 * @brief the gradients of the parameters accumulated since resetGradients
+	 */
+	const AlignedVector<flt_t>& weightsGradient() const {
+		return m_weightsGradient;
+	}
+	const AlignedVector<flt_t>& biasesGradient() const {
+		return m_biasesGradient;
+	}
+
+	virtual size_t weightCount() const {
+		return m_weights.size();
+	}
+
+	/**
+	 * @brief draws random parameters, with the standard deviation of the weights
+	 *   scaled by the number of inputs of every output
+	 */
+	virtual void initialize();
+
+	/**
+	 * @brief copies the parameters of a layer of the same kind and shape
+	 */
+	void setParameters(const Layer& other);
+
+	void resetGradients();
+	void resetVelocities();
+
+	/**
+	 * @brief applies the accumulated gradients with momentum, like the dense
+	 *   layers, and resets them for the next mini batch
+	 * @param etaScaled the learning rate divided by the size of the mini batch
+	 * @param weightDecayFactor scales the weights before adding the velocities
+	 * @param momentumCoefficient scales the previous velocities
+	 */
+	virtual void update(const flt_t etaScaled, const flt_t weightDecayFactor, const flt_t momentumCoefficient);
+
+	/**
+	 * @brief starts decaying the weights lazily until stopLazyWeightDecay, if
+	 *   the layer supports it; otherwise update keeps decaying them at once
+	 * @see Network::setLazyWeightDecay
+	 */
+	virtual void startLazyWeightDecay(const flt_t weightDecayFactor, const flt_t momentumCoefficient) {
+		(void)weightDecayFactor;
+		(void)momentumCoefficient;
+	}
+
+	/**
+	 * @brief brings the weights up to date during lazy weight decay
+	 * @see Network::foldWeightScales
+	 */
+	virtual void foldWeightDecay() {}
+
+	/**
+	 * @brief brings the weights up to date, and stops decaying them lazily
+	 */
+	virtual void stopLazyWeightDecay() {}
+
+	/**
+	 * @return the sum of the squares of the weights, for L2 regularization
+	 */
+	flt_t squaredWeightSum() const;
+
+	/**
+	 * @brief writes the name, the shape and the parameters
+	 * @see readLayer
+	 */
+	friend std::ostream& operator<<(std::ostream& out, const Layer& layer);
+
+protected:
+	/**
+	 * @param weightCount the number of weights
+	 * @param biasCount the number of biases
+	 * @param fanIn how many inputs every output depends on, on average
+	 */
+	Layer(const size_t weightCount, const size_t biasCount, const size_t fanIn);
+
+	/**
+	 * @brief writes what the constructor of the layer needs, read back by readLayer
+	 */
+	virtual void writeShape(std::ostream& out) const = 0;
+
+	/**
+	 * @brief writes the weights and then the biases
+	 */
+	virtual void writeParameters(std::ostream& out) const;
+
+	/**
+	 * @brief reads the parameters written by writeParameters
+	 */
+	virtual void readParameters(std::istream& in);
+
+	/**
+	 * @brief one of the buffers shared by the layers of the calling thread,
+	 *   whose content is only valid until another layer uses it
+	 * @param index which buffer, 0 or 1
+	 */
+	static AlignedVector<flt_t>& sharedBuffer(const size_t index);
+
+	size_t m_fanIn;
+	bool m_recomputation;
+
+	AlignedVector<flt_t> m_weights, m_biases;
+	AlignedVector<flt_t> m_weightsGradient, m_biasesGradient; // accumulated over the mini batch
+	AlignedVector<flt_t> m_weightsVelocity, m_biasesVelocity;
+
+	friend std::unique_ptr<Layer> readLayer(std::istream& in, const std::string& name,
+		const size_t inputSize, const size_t outputSize);
+};
+
+/**
+ * @brief reads a layer written by operator<<, after its name
+ * @param in input stream
+ * @param name the name already read, e.g. "conv2d"
+ * @param inputSize the size of the previous layer of the network, for the
+ *   layers whose shape is not written (dense)
+ * @param outputSize the size of the layer in the network, for the same layers
+ * @return the layer, or nullptr if no layer has that name
+ */
+std::unique_ptr<Layer> readLayer(std::istream& in, const std::string& name,
+	const size_t inputSize, const size_t outputSize);
+
+} // namespace nn
+
+#endif // _NN_LAYER_HPP_
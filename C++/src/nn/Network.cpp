@@ -1,9 +1,20 @@
 #include "Network.hpp"
+#include "Svd.hpp"
+#include "Optimizer.hpp"
 
 #include <numeric>
 #include <cmath>
 #include <algorithm>
 #include <iomanip>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <tuple>
+#include <cctype>
+#include <string>
+#include <stdexcept>
+#include <array>
+#include <atomic>
 
 using std::pair;
 using std::vector;
@@ -11,18 +22,112 @@ using vector_iter = vector<nn::Sample>::const_iterator;
 
 namespace nn {
 
+namespace {
+	// how many samples to retrieve at once when evaluating on a SampleSource
+	constexpr size_t evaluationBatchSize = 256;
+
+	// the first layer skips zero inputs when they are more than this fraction:
+	// indexed loads are slower than dense vectorized ones
+	constexpr double sparseInputDensity = 0.4;
+
+	// calculateBatch computes this many samples at once with matrix
+	// multiplications: enough to read every weight from memory once for
+	// many samples, and the unit of work of its threads
+	constexpr size_t batchTileSize = 256;
+	// the activations of a tile alternate between the two buffers of its
+	// thread, which keeps them from one calculateBatch to the next
+	thread_local std::array<AlignedVector<flt_t>, 2> tileBuffers;
+
+	/**
+	 * @brief Wilson score interval for the accuracy measured on a random subset
+	 *   of the test samples, with finite population correction
+	 * @param correct correctly recognized samples in the subset
+	 * @param total the size of the subset
+	 * @param population the number of all test samples
+	 * @param confidence e.g. 0.95
+	 * @return the lower and upper bound of the accuracy, in [0, 1]
+	 */
+	std::pair<double, double> accuracyInterval(const size_t correct, const size_t total,
+			const size_t population, const double confidence) {
+		if (total == 0)
+			return {0.0, 1.0};
+		const double p = (double)correct / total;
+		if (total >= population)
+			return {p, p};
+
+		// z such that erf(z/sqrt(2)) = confidence, found by bisection
+		double low = 0.0, high = 10.0;
+		for(int i = 0; i != 60; ++i) {
+			double mid = (low + high) / 2;
+			(std::erf(mid / std::sqrt(2.0)) < confidence ? low : high) = mid;
+		}
+		const double z = low;
+
+		// sampling without replacement has less variance: scale the sample size
+		const double n = total * (double)(population - 1) / (population - total);
+		const double center = (p + z*z / (2*n)) / (1 + z*z / n);
+		const double halfWidth = z / (1 + z*z / n) * std::sqrt(p*(1-p) / n + z*z / (4*n*n));
+		return {std::max(0.0, center - halfWidth), std::min(1.0, center + halfWidth)};
+	}
+
+	ActivationFunction& outputActivationFunction(const std::vector<size_t>& dimensions,
+			const std::vector<ActivationFunction*>& activationFunctions) {
+		if (activationFunctions.empty() || activationFunctions.size() + 1 != dimensions.size())
+			throw std::runtime_error{"Expected an activation function for every layer but the input layer"};
+		return *activationFunctions.back();
+	}
+}
+
 void Network::feedforward(const std::vector<flt_t>& inputs) {
+	m_activeInputs.clear();
 	for(size_t y = 0; y != m_nodes[0].size(); ++y) {
-		m_nodes[0][y].a = inputs[y]; // TODO consider putting inputs.at(y) or checking size
+		m_nodes[0].a[y] = inputs[y]; // TODO consider putting inputs.at(y) or checking size
+		if (inputs[y] != 0)
+			m_activeInputs.push_back(y);
 	}
-	for(size_t x = 1; x != m_nodes.size(); ++x) {
-		for(size_t y = 0; y != m_nodes[x].size(); ++y) {
-			m_nodes[x][y].z = m_nodes[x][y].bias;
-			for(size_t yFrom = 0; yFrom != m_nodes[x-1].size(); ++yFrom) {
-				m_nodes[x][y].z += m_nodes[x-1][yFrom].a * m_nodes[x][y].weights[yFrom];
-			}
-			m_nodes[x][y].a = m_activationFunction(m_nodes[x][y].z);
+	m_sparseInputs = m_activeInputs.size() < sparseInputDensity * m_nodes[0].size();
+	feedforwardLayers();
+}
+
+void Network::feedforward(const Sample& sample) {
+	if (sample.isSparse()) {
+		if (sample.getInputCount() != m_nodes[0].size())
+			throw std::runtime_error{"Sparse sample with " + std::to_string(sample.getInputCount())
+				+ " inputs for a network with " + std::to_string(m_nodes[0].size())};
+
+		// all inputs but the active ones are always 0, so only those need to be reset
+		for(auto&& y : m_activeInputs) {
+			m_nodes[0].a[y] = 0;
+		}
+		m_activeInputs.assign(sample.getNonzeroInputs().begin(), sample.getNonzeroInputs().end());
+		for(size_t i = 0; i != m_activeInputs.size(); ++i) {
+			m_nodes[0].a[m_activeInputs[i]] = sample.getNonzeroValues()[i];
 		}
+		m_sparseInputs = m_activeInputs.size() < sparseInputDensity * m_nodes[0].size();
+		feedforwardLayers();
+		return;
+	}
+
+	if (!sample.hasNonzeroInputs()) {
+		feedforward(sample.getInputs());
+		return;
+	}
+
+	const std::vector<flt_t>& inputs = sample.getInputs();
+	std::copy(inputs.begin(), inputs.begin() + m_nodes[0].size(), m_nodes[0].a.begin());
+	m_activeInputs.assign(sample.getNonzeroInputs().begin(), sample.getNonzeroInputs().end());
+	m_sparseInputs = m_activeInputs.size() < sparseInputDensity * m_nodes[0].size();
+	feedforwardLayers();
+}
+
+void Network::feedforwardLayers() {
+	for(size_t x = 1; x != m_nodes.size(); ++x) {
+		Nodes& nodes = m_nodes[x];
+		if (x == 1 && m_sparseInputs)
+			m_layers[x]->forwardSparse(m_nodes[0].a.data(), m_activeInputs, nodes.z.data());
+		else
+			m_layers[x]->forward(m_nodes[x-1].a.data(), nodes.z.data(), 1);
+		m_activationFunctions[x]->apply(nodes.z.data(), nodes.a.data(), nodes.size());
 	}
 }
 
@@ -31,112 +136,170 @@ void Network::momentumSGDMiniBatch(const std::vector<Sample>::const_iterator& sa
 		const flt_t eta,
 		const flt_t weightDecayFactor,
 		const flt_t momentumCoefficient) {
-	// reset
-	for(size_t x = 1; x != m_nodes.size(); ++x) {
-		for(size_t y = 0; y != m_nodes[x].size(); ++y) {
-			m_nodes[x][y].accBiasNabla = 0;
-			for(size_t yFrom = 0; yFrom != m_nodes[x-1].size(); ++yFrom) {
-				m_nodes[x][y].accWeightsNabla[yFrom] = 0;
-			}
-		}
-	}
-
-	// accumulate accNablas
+	// accumulate the gradients, which are 0 since the previous mini batch
 	for(auto s = samplesBegin; s != samplesEnd; ++s) {
 		backpropagation(*s);
-		for(size_t x = 1; x != m_nodes.size(); ++x) {
-			for(size_t y = 0; y != m_nodes[x].size(); ++y) {
-				m_nodes[x][y].accBiasNabla += m_nodes[x][y].error;
-				for(size_t yFrom = 0; yFrom != m_nodes[x-1].size(); ++yFrom) {
-					m_nodes[x][y].accWeightsNabla[yFrom] += m_nodes[x][y].weightsNabla[yFrom];
-				}
-			}
-		}
 	}
 
-	// apply calculated accNablas to velocities
+	// apply the gradients to velocities and velocities to parameters,
+	// resetting the gradients in the same sweep
+	Profiler::Scope scope{m_profiler, Profiler::update};
 	size_t m = std::distance(samplesBegin, samplesEnd); // mini batch size
 	flt_t etaScaled = eta / m;
 	for(size_t x = 1; x != m_nodes.size(); ++x) {
-		for(size_t y = 0; y != m_nodes[x].size(); ++y) {
-			m_nodes[x][y].biasVelocity =
-				momentumCoefficient * m_nodes[x][y].biasVelocity -
-				etaScaled * m_nodes[x][y].accBiasNabla;
-			for(size_t yFrom = 0; yFrom != m_nodes[x-1].size(); ++yFrom) {
-				m_nodes[x][y].weightsVelocity[yFrom] =
-					momentumCoefficient * m_nodes[x][y].weightsVelocity[yFrom] -
-					etaScaled * m_nodes[x][y].accWeightsNabla[yFrom];
-			}
-		}
-	}
-
-	// apply calculated velocities to weights
-	for(size_t x = 1; x != m_nodes.size(); ++x) {
-		for(size_t y = 0; y != m_nodes[x].size(); ++y) {
-			m_nodes[x][y].bias += m_nodes[x][y].biasVelocity;
-			for(size_t yFrom = 0; yFrom != m_nodes[x-1].size(); ++yFrom) {
-				m_nodes[x][y].weights[yFrom] =
-					weightDecayFactor * m_nodes[x][y].weights[yFrom] +
-					m_nodes[x][y].weightsVelocity[yFrom];
-			}
-		}
+		m_layers[x]->update(etaScaled, weightDecayFactor, momentumCoefficient);
 	}
 }
 
 void Network::backpropagation(const Sample& sample) {
 	// feedforward
-	feedforward(sample.getInputs());
+	{
+		Profiler::Scope scope{m_profiler, Profiler::forward};
+		feedforward(sample);
+	}
 
 	// backpropagation of output layer
-	for(size_t y = 0; y != m_nodes.back().size(); ++y) {
-		m_nodes.back()[y].error = m_costFunction.derivative(m_nodes.back()[y].z, m_nodes.back()[y].a, sample.getExpectedOutputs()[y], m_activationFunction);
-		// ^ TODO consider putting sample.getExpectedOutputs().at(y) or checking size
+	Profiler::Scope scope{m_profiler, Profiler::backward};
+	Nodes& outputs = m_nodes.back();
+	const ActivationFunction& outputFunction = *m_activationFunctions.back();
+	// e.g. softmax with categorical cross entropy: the error is a single subtraction
+	const bool difference = m_costFunction.isDifference(outputFunction);
+	const bool onlyExpectedClass = sample.hasOnlyExpectedClass();
+	size_t actualClass = 0, expectedClass = onlyExpectedClass ? sample.getExpectedClass() : 0;
+	flt_t maxExpected = sample.getExpectedOutput(expectedClass);
+	for(size_t y = 0; y != outputs.size(); ++y) {
+		const flt_t expected = sample.getExpectedOutput(y);
+		outputs.error[y] = difference ? outputs.a[y] - expected
+			: m_costFunction.derivative(outputs.z[y], outputs.a[y], expected, outputFunction);
+		// ^ TODO consider checking the size of the expected outputs
 
-		for(size_t yFrom = 0; yFrom != m_nodes.end()[-2].size(); ++yFrom) {
-			m_nodes.back()[y].weightsNabla[yFrom] = m_nodes.back()[y].error * m_nodes.end()[-2][yFrom].a;
+		// the outputs are already there: the training statistics are almost free
+		m_trainingStatistics.cost += m_costFunction(outputs.a[y], expected);
+		if (outputs.a[y] > outputs.a[actualClass])
+			actualClass = y;
+		if (!onlyExpectedClass && expected > maxExpected) {
+			expectedClass = y;
+			maxExpected = expected;
 		}
 	}
+	backpropagateLayer(m_nodes.size() - 1);
+
+	++m_trainingStatistics.samples;
+	if (!sample.isAutoclassifier() && m_nodes.back().size() > 1) {
+		++m_trainingStatistics.classified;
+		m_trainingStatistics.correct += actualClass == expectedClass;
+	}
 
 	// backpropagation
 	for(size_t x = m_nodes.size()-2; x != 0; --x) {
-		for(size_t y = 0; y != m_nodes[x].size(); ++y) {
-			flt_t sd = m_activationFunction.derivative(m_nodes[x][y].z);
-
-			m_nodes[x][y].error = 0;
-			for(size_t yTo = 0; yTo != m_nodes[x+1].size(); ++yTo) {
-				m_nodes[x][y].error += m_nodes[x+1][yTo].weights[y] * m_nodes[x+1][yTo].error * sd;
-			}
-			for(size_t yFrom = 0; yFrom != m_nodes[x-1].size(); ++yFrom) {
-				m_nodes[x][y].weightsNabla[yFrom] = m_nodes[x][y].error * m_nodes[x-1][yFrom].a;
-			}
+		Nodes& nodes = m_nodes[x];
+		m_layerBuffer.resize(nodes.size());
+		m_activationFunctions[x]->derivatives(nodes.z.data(), m_layerBuffer.data(), nodes.size());
+		for(size_t y = 0; y != nodes.size(); ++y) {
+			nodes.error[y] *= m_layerBuffer[y];
 		}
+		backpropagateLayer(x);
 	}
 }
 
+void Network::backpropagateLayer(const size_t layer) {
+	const flt_t* errors = m_nodes[layer].error.data();
+	if (layer == 1 && m_sparseInputs) {
+		m_layers[layer]->backwardSparse(m_nodes[0].a.data(), m_activeInputs, errors);
+		return;
+	}
+	// the inputs have no error
+	m_layers[layer]->backward(m_nodes[layer-1].a.data(), errors,
+		layer > 1 ? m_nodes[layer-1].error.data() : nullptr, 1);
+}
+
+DenseLayer* Network::denseLayer(const size_t layer) const {
+	return dynamic_cast<DenseLayer*>(m_layers[layer].get());
+}
+
+void Network::resetOptimizer() {
+	for(size_t x = 1; x != m_nodes.size(); ++x) {
+		m_layers[x]->resetGradients();
+		m_layers[x]->resetVelocities();
+	}
+}
 
 void Network::momentumSGDEpoch(std::vector<Sample>& trainingSamples,
 		const size_t miniBatchSize,
 		const flt_t eta,
 		const flt_t regularizationParameter,
-		const flt_t momentumCoefficient) {
-	// reset velocities
-	for(size_t x = 1; x != m_nodes.size(); ++x) {
-		for(size_t y = 0; y != m_nodes[x].size(); ++y) {
-			m_nodes[x][y].biasVelocity = 0;
-			for(size_t yFrom = 0; yFrom != m_nodes[x-1].size(); ++yFrom) {
-				m_nodes[x][y].weightsVelocity[yFrom] = 0;
-			}
-		}
-	}
+		const flt_t momentumCoefficient,
+		const std::function<void(const size_t, const size_t)>& afterMiniBatch) {
+	m_trainingStatistics = {};
+
+	resetOptimizer();
 	
-	std::random_shuffle(trainingSamples.begin(), trainingSamples.end());
+	{
+		Profiler::Scope scope{m_profiler, Profiler::shuffle};
+		std::shuffle(trainingSamples.begin(), trainingSamples.end(), randomEngine());
+	}
 	
 	flt_t weightDecayFactor = (1 - eta * regularizationParameter / trainingSamples.size());
+	startLazyWeightDecay(weightDecayFactor, momentumCoefficient);
 	for(size_t start = 0; start < trainingSamples.size(); start += miniBatchSize) {
 		auto beg = trainingSamples.begin() + start;
 		auto end = std::min(beg + miniBatchSize, trainingSamples.end());
 
 		momentumSGDMiniBatch(beg, end, eta, weightDecayFactor, momentumCoefficient);
+		if (afterMiniBatch)
+			afterMiniBatch(start / miniBatchSize, std::distance(beg, end));
+	}
+	stopLazyWeightDecay();
+}
+
+void Network::momentumSGDEpoch(SampleSource& trainingSamples,
+		const size_t miniBatchSize,
+		const flt_t eta,
+		const flt_t regularizationParameter,
+		const flt_t momentumCoefficient,
+		const std::function<void(const size_t, const size_t)>& afterMiniBatch) {
+	m_trainingStatistics = {};
+
+	resetOptimizer();
+
+	{
+		Profiler::Scope scope{m_profiler, Profiler::shuffle};
+		trainingSamples.rewind(miniBatchSize);
+	}
+
+	flt_t weightDecayFactor = (1 - eta * regularizationParameter / trainingSamples.size());
+	startLazyWeightDecay(weightDecayFactor, momentumCoefficient);
+	std::vector<Sample> miniBatch;
+	for(size_t index = 0; trainingSamples.nextBatch(miniBatch); ++index) {
+		momentumSGDMiniBatch(miniBatch.begin(), miniBatch.end(), eta, weightDecayFactor, momentumCoefficient);
+		if (afterMiniBatch)
+			afterMiniBatch(index, miniBatch.size());
+	}
+	stopLazyWeightDecay();
+}
+
+void Network::startLazyWeightDecay(const flt_t weightDecayFactor, const flt_t momentumCoefficient) {
+	if (!m_lazyWeightDecay)
+		return;
+	for(size_t x = 1; x != m_nodes.size(); ++x) {
+		m_layers[x]->startLazyWeightDecay(weightDecayFactor, momentumCoefficient);
+	}
+}
+
+void Network::stopLazyWeightDecay() {
+	for(size_t x = 1; x != m_nodes.size(); ++x) {
+		m_layers[x]->stopLazyWeightDecay();
+	}
+}
+
+void Network::setLazyWeightDecay(const bool enabled) {
+	stopLazyWeightDecay();
+	m_lazyWeightDecay = enabled;
+}
+
+void Network::foldWeightScales() {
+	for(size_t x = 1; x != m_nodes.size(); ++x) {
+		m_layers[x]->foldWeightDecay();
 	}
 }
 
@@ -144,38 +307,267 @@ void Network::momentumSGDEpoch(std::vector<Sample>& trainingSamples,
 Network::Network(const std::initializer_list<size_t>& dimensions,
 		ActivationFunction& activationFunction,
 		CostFunction& costFunction) :
+		Network{std::vector<size_t>(dimensions), activationFunction, costFunction} {}
+
+Network::Network(const std::vector<size_t>& dimensions,
+		ActivationFunction& activationFunction,
+		CostFunction& costFunction) :
+		Network{dimensions,
+			std::vector<ActivationFunction*>(std::max<size_t>(dimensions.size(), 1) - 1, &activationFunction),
+			costFunction} {}
+
+Network::Network(ActivationFunction& activationFunction, CostFunction& costFunction) :
 		m_nodes{}, m_activationFunction{activationFunction},
-		m_costFunction{costFunction} {
-	m_nodes.push_back({});
-	for(size_t y = 0; y != dimensions.begin()[0]; ++y) {
-		// inputs have no input-connections
-		m_nodes.back().push_back(Node{0});
-	}
+		m_activationFunctions{}, m_layers{}, m_costFunction{costFunction},
+		m_layerBuffer{}, m_recomputation{false},
+		m_activeInputs{}, m_sparseInputs{false}, m_lazyWeightDecay{false}, m_profiler{},
+		m_evaluationSchedule{}, m_evaluationEngine{m_evaluationSchedule.seed},
+		m_snapshot{}, m_pendingEvaluation{}, m_trainingStatistics{}, m_threadPool{} {}
+
+Network::Network(const std::vector<size_t>& dimensions,
+		const std::vector<ActivationFunction*>& activationFunctions,
+		CostFunction& costFunction) :
+		Network{dimensions, activationFunctions,
+			std::vector<const Layer*>(activationFunctions.size(), nullptr),
+			costFunction} {}
+
+Network::Network(const std::vector<size_t>& dimensions,
+		const std::vector<ActivationFunction*>& activationFunctions,
+		const std::vector<const Layer*>& layers,
+		CostFunction& costFunction) :
+		m_nodes{}, m_activationFunction{outputActivationFunction(dimensions, activationFunctions)},
+		m_activationFunctions{}, m_layers{}, m_costFunction{costFunction},
+		m_layerBuffer{}, m_recomputation{false},
+		m_activeInputs{}, m_sparseInputs{false}, m_lazyWeightDecay{false}, m_profiler{},
+		m_evaluationSchedule{}, m_evaluationEngine{m_evaluationSchedule.seed},
+		m_snapshot{}, m_pendingEvaluation{}, m_trainingStatistics{}, m_threadPool{} {
+	if (layers.size() != activationFunctions.size())
+		throw std::runtime_error{"Expected a layer or nullptr for every layer but the input layer"};
+	m_activationFunctions.push_back(nullptr);
+	m_activationFunctions.insert(m_activationFunctions.end(), activationFunctions.begin(), activationFunctions.end());
+	m_layers.push_back(nullptr);
+
+	// inputs have no input-connections
+	m_nodes.emplace_back(dimensions[0]);
+	// every input may be active: feedforward never grows it
+	m_activeInputs.reserve(dimensions[0]);
 
 	for(size_t x = 1; x != dimensions.size(); ++x) {
-		m_nodes.push_back({});
-		for(size_t y = 0; y != dimensions.begin()[x]; ++y) {
-			m_nodes.back().push_back(Node{dimensions.begin()[x-1]});
-			m_nodes.back().back().bias = random(1);
-
-			flt_t standardDeviation = 1.0 / std::sqrt(dimensions.begin()[x-1]);
-			for(size_t yFrom = 0; yFrom != dimensions.begin()[x-1]; ++yFrom) {
-				m_nodes.back().back().weights[yFrom] = random(standardDeviation);
-			}
+		m_nodes.emplace_back(dimensions[x]);
+		if (const Layer* layer = layers[x-1]) {
+			if (layer->inputSize() != dimensions[x-1] || layer->outputSize() != dimensions[x])
+				throw std::runtime_error{std::string{"The "} + layer->name() + " layer " + std::to_string(x) + " takes "
+					+ std::to_string(layer->inputSize()) + " inputs and has "
+					+ std::to_string(layer->outputSize()) + " outputs, instead of "
+					+ std::to_string(dimensions[x-1]) + " and " + std::to_string(dimensions[x])};
+			m_layers.push_back(layer->clone());
+		} else {
+			m_layers.push_back(std::make_unique<DenseLayer>(dimensions[x-1], dimensions[x]));
 		}
+		m_layers.back()->initialize();
 	}
+	checkActivationFunctions();
 }
 
-Network::Network(ActivationFunction& activationFunction, CostFunction& costFunction) :
-		m_nodes{}, m_activationFunction{activationFunction},
-		m_costFunction{costFunction} {}
+void Network::setActivationFunction(const size_t layer, ActivationFunction& activationFunction) {
+	if (layer == 0 || layer >= m_nodes.size())
+		throw std::runtime_error{"Invalid layer " + std::to_string(layer) + " for an activation function"};
+	m_activationFunctions[layer] = &activationFunction;
+	checkActivationFunctions();
+}
+
+void Network::checkActivationFunctions() const {
+	for(size_t x = 1; x != m_activationFunctions.size(); ++x) {
+		if (m_activationFunctions[x]->isElementwise())
+			continue;
+		if (x != m_activationFunctions.size() - 1)
+			throw std::runtime_error{std::string{"The activation function "} + m_activationFunctions[x]->name()
+				+ " can only be used for the output layer"};
+		if (!m_costFunction.isDifference(*m_activationFunctions[x]))
+			throw std::runtime_error{std::string{"The activation function "} + m_activationFunctions[x]->name()
+				+ " can not be used with this cost function"};
+	}
+}
+
+void Network::pruneByMagnitude(const flt_t sparsity) {
+	foldWeightScales();
+	if (!(sparsity >= 0 && sparsity <= 1))
+		throw std::runtime_error{"Invalid pruning sparsity " + std::to_string(sparsity)};
+
+	for(size_t x = 1; x != m_nodes.size(); ++x) {
+		if (DenseLayer* layer = denseLayer(x))
+			layer->pruneByMagnitude(sparsity);
+	}
+}
+
+void Network::pruneTopK(const size_t k) {
+	foldWeightScales();
+	for(size_t x = 1; x != m_nodes.size(); ++x) {
+		if (DenseLayer* layer = denseLayer(x))
+			layer->pruneTopK(k);
+	}
+}
+
+void Network::clearPruningMask() {
+	foldWeightScales();
+	for(size_t x = 1; x != m_nodes.size(); ++x) {
+		if (DenseLayer* layer = denseLayer(x))
+			layer->clearPruningMask();
+	}
+}
+
+size_t Network::prunedWeightCount() const {
+	size_t count = 0;
+	for(size_t x = 1; x != m_nodes.size(); ++x) {
+		if (const DenseLayer* layer = denseLayer(x))
+			count += layer->prunedWeightCount();
+	}
+	return count;
+}
+
+void Network::factorizeLayer(const size_t layer, const size_t rank) {
+	if (layer == 0 || layer >= m_nodes.size())
+		throw std::runtime_error{"Invalid layer " + std::to_string(layer) + " to factorize"};
+	const DenseLayer* dense = denseLayer(layer);
+	if (!dense)
+		throw std::runtime_error{std::string{"Cannot factorize the "} + m_layers[layer]->name() + " layer " + std::to_string(layer)};
+	const size_t inputs = m_nodes[layer-1].size(), outputs = m_nodes[layer].size();
+	if (rank == 0 || rank > std::min(inputs, outputs))
+		throw std::runtime_error{"Invalid rank " + std::to_string(rank) + " for a layer of "
+			+ std::to_string(inputs) + "x" + std::to_string(outputs)};
+	// the layers change: the weights cannot be scaled anymore until the next epoch
+	stopLazyWeightDecay();
+
+	std::vector<double> weights(outputs * inputs);
+	for(size_t y = 0; y != outputs; ++y) {
+		std::copy_n(dense->row(y), inputs, weights.begin() + y * inputs);
+	}
+	const TruncatedSvd svd = truncatedSvd(weights, outputs, inputs, rank);
+
+	// the singular values are split between the two layers, so that their
+	// weights have similar magnitudes and train at similar speeds
+	auto projection = std::make_unique<DenseLayer>(inputs, rank);
+	for(size_t c = 0; c != rank; ++c) {
+		const double scale = std::sqrt(svd.singularValues[c]);
+		for(size_t yFrom = 0; yFrom != inputs; ++yFrom) {
+			projection->row(c)[yFrom] = svd.v[yFrom*rank + c] * scale;
+		}
+	}
+	auto reconstruction = std::make_unique<DenseLayer>(rank, outputs);
+	for(size_t y = 0; y != outputs; ++y) {
+		reconstruction->biases()[y] = dense->biases()[y];
+		for(size_t c = 0; c != rank; ++c) {
+			reconstruction->row(y)[c] = svd.u[y*rank + c] * std::sqrt(svd.singularValues[c]);
+		}
+	}
+
+	m_layers[layer] = std::move(reconstruction);
+	m_nodes.insert(m_nodes.begin() + layer, Nodes(rank));
+	m_activationFunctions.insert(m_activationFunctions.begin() + layer, &linear);
+	m_layers.insert(m_layers.begin() + layer, std::move(projection));
+}
+
+std::vector<flt_t> Network::calculate(const Sample& sample) {
+	const flt_t* outputs = calculateView(sample);
+	return std::vector<flt_t>(outputs, outputs + outputCount());
+}
 
 std::vector<flt_t> Network::calculate(const std::vector<flt_t>& inputs) {
+	const flt_t* outputs = calculateView(inputs);
+	return std::vector<flt_t>(outputs, outputs + outputCount());
+}
+
+void Network::calculate(const Sample& sample, flt_t* outputs) {
+	std::copy_n(calculateView(sample), outputCount(), outputs);
+}
+
+void Network::calculate(const std::vector<flt_t>& inputs, flt_t* outputs) {
+	std::copy_n(calculateView(inputs), outputCount(), outputs);
+}
+
+const flt_t* Network::calculateView(const Sample& sample) {
+	feedforward(sample);
+	return m_nodes.back().a.data();
+}
+
+const flt_t* Network::calculateView(const std::vector<flt_t>& inputs) {
 	feedforward(inputs);
-	std::vector<flt_t> result;
-	for(size_t i = 0; i != m_nodes.back().size(); ++i)
-		result.push_back(m_nodes.back()[i].a);
-	return result;
+	return m_nodes.back().a.data();
+}
+
+size_t Network::outputCount() const {
+	return m_nodes.back().size();
+}
+
+void Network::calculateBatch(const flt_t* inputs, const size_t batchSize, flt_t* outputs, const size_t threads) {
+	foldWeightScales();
+
+	const size_t tiles = (batchSize + batchTileSize - 1) / batchTileSize;
+	std::atomic<size_t> nextTile{0};
+	// the layers infer without state, so all the threads share them
+	auto calculateTiles = [&](const size_t) {
+		for(size_t tile = nextTile++; tile < tiles; tile = nextTile++) {
+			const size_t first = tile * batchTileSize, rows = std::min(batchTileSize, batchSize - first);
+			const flt_t* a = inputs + first * m_nodes[0].size();
+			for(size_t x = 1; x != m_nodes.size(); ++x) {
+				const size_t width = m_nodes[x].size();
+				AlignedVector<flt_t>& z = tileBuffers[x % 2];
+				z.resize(rows * width);
+				m_layers[x]->infer(a, z.data(), rows);
+
+				const ActivationFunction& function = *m_activationFunctions[x];
+				if (function.isElementwise()) {
+					function.apply(z.data(), z.data(), rows * width);
+				} else {
+					for(size_t row = 0; row != rows; ++row)
+						function.apply(z.data() + row * width, z.data() + row * width, width);
+				}
+				a = z.data();
+			}
+			std::copy_n(a, rows * outputCount(), outputs + first * outputCount());
+		}
+	};
+
+	const size_t workers = std::max<size_t>(1, std::min(threads, tiles));
+	if (workers == 1) {
+		calculateTiles(0);
+		return;
+	}
+	if (!m_threadPool)
+		m_threadPool = std::make_unique<ThreadPool>();
+	m_threadPool->run(workers, calculateTiles);
+}
+
+std::vector<flt_t> Network::calculateBatch(const std::vector<flt_t>& inputs, const size_t threads) {
+	const size_t inputCount = m_nodes[0].size();
+	if (inputCount == 0 || inputs.size() % inputCount != 0)
+		throw std::runtime_error{"A batch of " + std::to_string(inputs.size())
+			+ " inputs for a network with " + std::to_string(inputCount)};
+	const size_t batchSize = inputs.size() / inputCount;
+	std::vector<flt_t> outputs(batchSize * outputCount());
+	calculateBatch(inputs.data(), batchSize, outputs.data(), threads);
+	return outputs;
+}
+
+std::vector<flt_t> Network::calculateBatch(const std::vector<Sample>& samples, const size_t threads) {
+	const size_t inputCount = m_nodes[0].size();
+	std::vector<flt_t> inputs(samples.size() * inputCount);
+	for(size_t i = 0; i != samples.size(); ++i) {
+		const Sample& sample = samples[i];
+		if (sample.getInputCount() != inputCount)
+			throw std::runtime_error{"Sample with " + std::to_string(sample.getInputCount())
+				+ " inputs for a network with " + std::to_string(inputCount)};
+		flt_t* row = inputs.data() + i * inputCount;
+		if (sample.isSparse()) {
+			for(size_t j = 0; j != sample.getNonzeroInputs().size(); ++j)
+				row[sample.getNonzeroInputs()[j]] = sample.getNonzeroValues()[j];
+		} else {
+			std::copy(sample.getInputs().begin(), sample.getInputs().end(), row);
+		}
+	}
+	std::vector<flt_t> outputs(samples.size() * outputCount());
+	calculateBatch(inputs.data(), samples.size(), outputs.data(), threads);
+	return outputs;
 }
 
 void Network::SGD(std::vector<Sample> trainingSamples,
@@ -198,28 +590,302 @@ void Network::momentumSGD(std::vector<Sample> trainingSamples,
 		const std::vector<Sample>& testSamples,
 		std::ostream& out,
 		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare) {
-	out << "Before " << std::setw(std::log10(epochs+1)) << "" <<
-		"  -  Accuracy: " << std::setw(std::log10(testSamples.size()) + 1) << evaluate(testSamples, compare) << " / " << testSamples.size() <<
-		"  -  Cost: " << cost(testSamples, regularizationParameter) << "\n";
-	for(size_t e = 0; e != epochs; ++e) {
-		momentumSGDEpoch(trainingSamples, miniBatchSize, eta, regularizationParameter, momentumCoefficient);
-		out << "Epoch " << std::setw(std::log10(epochs+1) + 1) << e+1 <<
-			"  -  Accuracy: " << std::setw(std::log10(testSamples.size()) + 1) << evaluate(testSamples, compare) << " / " << testSamples.size() <<
-			"  -  Cost: " << cost(testSamples, regularizationParameter) << "\n";
+	StreamPrinter printer{out};
+	runMomentumSGD(trainingSamples, epochs, miniBatchSize, eta, regularizationParameter, momentumCoefficient, testSamples, printer, compare);
+}
+
+void Network::momentumSGD(SampleSource& trainingSamples,
+		const size_t epochs,
+		const size_t miniBatchSize,
+		const flt_t eta,
+		const flt_t regularizationParameter,
+		const flt_t momentumCoefficient,
+		const std::vector<Sample>& testSamples,
+		std::ostream& out,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare) {
+	StreamPrinter printer{out};
+	runMomentumSGD(trainingSamples, epochs, miniBatchSize, eta, regularizationParameter, momentumCoefficient, testSamples, printer, compare);
+}
+
+void Network::momentumSGD(SampleSource& trainingSamples,
+		const size_t epochs,
+		const size_t miniBatchSize,
+		const flt_t eta,
+		const flt_t regularizationParameter,
+		const flt_t momentumCoefficient,
+		SampleSource& testSamples,
+		std::ostream& out,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare) {
+	StreamPrinter printer{out};
+	runMomentumSGD(trainingSamples, epochs, miniBatchSize, eta, regularizationParameter, momentumCoefficient, testSamples, printer, compare);
+}
+
+void Network::momentumSGD(std::vector<Sample> trainingSamples,
+		const size_t epochs,
+		const size_t miniBatchSize,
+		const flt_t eta,
+		const flt_t regularizationParameter,
+		const flt_t momentumCoefficient,
+		const std::vector<Sample>& testSamples,
+		TrainingObserver& observer,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare) {
+	runMomentumSGD(trainingSamples, epochs, miniBatchSize, eta, regularizationParameter, momentumCoefficient, testSamples, observer, compare);
+}
+
+void Network::momentumSGD(SampleSource& trainingSamples,
+		const size_t epochs,
+		const size_t miniBatchSize,
+		const flt_t eta,
+		const flt_t regularizationParameter,
+		const flt_t momentumCoefficient,
+		const std::vector<Sample>& testSamples,
+		TrainingObserver& observer,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare) {
+	runMomentumSGD(trainingSamples, epochs, miniBatchSize, eta, regularizationParameter, momentumCoefficient, testSamples, observer, compare);
+}
+
+void Network::momentumSGD(SampleSource& trainingSamples,
+		const size_t epochs,
+		const size_t miniBatchSize,
+		const flt_t eta,
+		const flt_t regularizationParameter,
+		const flt_t momentumCoefficient,
+		SampleSource& testSamples,
+		TrainingObserver& observer,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare) {
+	runMomentumSGD(trainingSamples, epochs, miniBatchSize, eta, regularizationParameter, momentumCoefficient, testSamples, observer, compare);
+}
+
+template<class TrainingSamples, class TestSamples>
+void Network::runMomentumSGD(TrainingSamples& trainingSamples,
+		const size_t epochs,
+		const size_t miniBatchSize,
+		const flt_t eta,
+		const flt_t regularizationParameter,
+		const flt_t momentumCoefficient,
+		TestSamples& testSamples,
+		TrainingObserver& observer,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare) {
+	const EvaluationSchedule& schedule = m_evaluationSchedule;
+	if (schedule.beforeTraining)
+		evaluateAndNotify(observer, 0, epochs, 0, testSamples, regularizationParameter, compare);
+
+	for(size_t e = 1; e <= epochs; ++e) {
+		observer.onEpochStart({e, epochs});
+
+		m_profiler.reset();
+		auto start = std::chrono::steady_clock::now();
+		momentumSGDEpoch(trainingSamples, miniBatchSize, eta, regularizationParameter, momentumCoefficient,
+			[&](const size_t miniBatch, const size_t samples) {
+				observer.onMiniBatch({e, miniBatch, samples});
+				notifyBackgroundEvaluation(observer, false);
+				if (schedule.everyMiniBatches != 0 && (miniBatch+1) % schedule.everyMiniBatches == 0)
+					evaluateAndNotify(observer, e, epochs, miniBatch+1, testSamples, regularizationParameter, compare);
+			});
+		double epochSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// evaluation is profiled as part of the epoch it follows
+		if (schedule.everyEpochs != 0 && (e % schedule.everyEpochs == 0 || e == epochs))
+			evaluateAndNotify(observer, e, epochs, 0, testSamples, regularizationParameter, compare);
+		notifyBackgroundEvaluation(observer, e == epochs);
+
+		EpochEndEvent event{};
+		event.epoch = e;
+		event.epochs = epochs;
+		event.samples = trainingSamples.size();
+		event.seconds = epochSeconds;
+		event.samplesPerSecond = event.samples / epochSeconds;
+		event.gflops = trainingFlops(event.samples, miniBatchSize) / epochSeconds * 1e-9;
+		event.activationBytes = activationBytes();
+		event.trainingCost = m_trainingStatistics.samples == 0 ? 0.0 : m_trainingStatistics.cost / m_trainingStatistics.samples;
+		event.trainingCorrect = m_trainingStatistics.correct;
+		event.trainingClassified = m_trainingStatistics.classified;
+		event.profiled = m_profiler.isEnabled();
+		event.counted = m_profiler.isCounting();
+		for(size_t phase = 0; phase != Profiler::phaseCount; ++phase) {
+			event.phaseSeconds[phase] = m_profiler.seconds((Profiler::Phase)phase);
+			event.phaseCounts[phase] = m_profiler.counts((Profiler::Phase)phase);
+		}
+		for(size_t c = 0; c != PerfCounters::counterCount; ++c)
+			event.countersAvailable[c] = m_profiler.isCounterAvailable((PerfCounters::Counter)c);
+		observer.onEpochEnd(event);
 	}
+
+	// the background evaluation reads the test samples, which may not outlive
+	// this call, and reports to this observer: wait for it even without epochs
+	notifyBackgroundEvaluation(observer, true);
+}
+
+template<class TestSamples>
+void Network::evaluateAndNotify(TrainingObserver& observer,
+		const size_t epoch,
+		const size_t epochs,
+		const size_t miniBatch,
+		TestSamples& testSamples,
+		const flt_t regularizationParameter,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare) {
+	if (!m_evaluationSchedule.background) {
+		observer.onEvaluation(evaluation(epoch, epochs, miniBatch, testSamples, regularizationParameter, compare));
+		return;
+	}
+
+	// the snapshot can only be overwritten after the previous evaluation is done
+	notifyBackgroundEvaluation(observer, true);
+	updateSnapshot();
+	m_pendingEvaluation = std::async(std::launch::async, [=, &testSamples, snapshot = m_snapshot.get()] {
+		return snapshot->evaluation(epoch, epochs, miniBatch, testSamples, regularizationParameter, compare);
+	});
+}
+
+void Network::notifyBackgroundEvaluation(TrainingObserver& observer, const bool wait) {
+	if (!m_pendingEvaluation.valid())
+		return;
+	if (wait || m_pendingEvaluation.wait_for(std::chrono::seconds{0}) == std::future_status::ready)
+		observer.onEvaluation(m_pendingEvaluation.get());
+}
+
+void Network::updateSnapshot() {
+	foldWeightScales();
+	if (!m_snapshot) {
+		m_snapshot = std::make_unique<Network>(m_activationFunction, m_costFunction);
+		m_snapshot->setEvaluationSchedule(m_evaluationSchedule);
+	}
+	m_snapshot->m_evaluationSchedule = m_evaluationSchedule;
+	m_snapshot->m_evaluationSchedule.background = false;
+	m_snapshot->m_activationFunctions = m_activationFunctions;
+
+	bool sameTopology = m_snapshot->m_nodes.size() == m_nodes.size();
+	for(size_t x = 1; sameTopology && x != m_nodes.size(); ++x)
+		sameTopology = m_snapshot->m_layers[x]->name() == std::string{m_layers[x]->name()}
+			&& m_snapshot->m_layers[x]->inputSize() == m_layers[x]->inputSize()
+			&& m_snapshot->m_layers[x]->outputSize() == m_layers[x]->outputSize()
+			&& m_snapshot->m_layers[x]->weightCount() == m_layers[x]->weightCount();
+	if (!sameTopology) {
+		m_snapshot->m_nodes.clear();
+		for(auto&& nodes : m_nodes)
+			m_snapshot->m_nodes.emplace_back(nodes.size());
+		m_snapshot->m_activeInputs.clear();
+		m_snapshot->m_layers.clear();
+		m_snapshot->m_layers.push_back(nullptr);
+		for(size_t x = 1; x != m_nodes.size(); ++x) {
+			m_snapshot->m_layers.push_back(m_layers[x]->clone());
+			// the snapshot is not trained, its weights must not be scaled
+			m_snapshot->m_layers.back()->stopLazyWeightDecay();
+		}
+		return;
+	}
+
+	// only the parameters are needed, not the training state
+	for(size_t x = 1; x != m_nodes.size(); ++x) {
+		m_snapshot->m_layers[x]->setParameters(*m_layers[x]);
+	}
+}
+
+template<class TestSamples>
+EvaluationEvent Network::evaluation(const size_t epoch,
+		const size_t epochs,
+		const size_t miniBatch,
+		TestSamples& testSamples,
+		const flt_t regularizationParameter,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare) {
+	const EvaluationSchedule& schedule = m_evaluationSchedule;
+	EvaluationEvent event{};
+	event.epoch = epoch;
+	event.epochs = epochs;
+	event.miniBatch = miniBatch;
+	event.population = testSamples.size();
+	event.subsampled = schedule.subsetSize != 0 && schedule.subsetSize < testSamples.size();
+	event.hasCost = schedule.computeCost;
+
+	if (event.subsampled) {
+		std::vector<Sample> subset = validationSubset(testSamples, schedule.subsetSize);
+		event.correct = evaluate(subset, compare);
+		event.total = subset.size();
+		if (event.hasCost)
+			event.cost = cost(subset, regularizationParameter);
+	} else {
+		event.correct = evaluate(testSamples, compare);
+		event.total = testSamples.size();
+		if (event.hasCost)
+			event.cost = cost(testSamples, regularizationParameter);
+	}
+
+	std::tie(event.accuracyLow, event.accuracyHigh) =
+		accuracyInterval(event.correct, event.total, event.population, schedule.confidence);
+	return event;
+}
+
+std::vector<Sample> Network::validationSubset(const std::vector<Sample>& testSamples, const size_t size) {
+	std::vector<Sample> subset;
+	subset.reserve(size);
+	std::sample(testSamples.begin(), testSamples.end(), std::back_inserter(subset), size, m_evaluationEngine);
+	return subset;
+}
+
+std::vector<Sample> Network::validationSubset(SampleSource& testSamples, const size_t size) {
+	// reservoir sampling over a whole pass: the subset is uniformly random
+	// whatever the order of the source, as the confidence interval assumes
+	std::vector<Sample> subset, batch;
+	subset.reserve(size);
+	size_t seen = 0;
+	testSamples.rewind(evaluationBatchSize);
+	while(testSamples.nextBatch(batch)) {
+		for(auto&& sample : batch) {
+			if (subset.size() < size) {
+				subset.push_back(std::move(sample));
+			} else {
+				const size_t slot = std::uniform_int_distribution<size_t>{0, seen}(m_evaluationEngine);
+				if (slot < size)
+					subset[slot] = std::move(sample);
+			}
+			++seen;
+		}
+	}
+	return subset;
+}
+
+void Network::setEvaluationSchedule(const EvaluationSchedule& schedule) {
+	m_evaluationSchedule = schedule;
+	m_evaluationEngine.seed(schedule.seed);
+	// e.g. from an observer during training: the evaluation in the background
+	// uses the snapshot, and is still delivered afterwards
+	if (m_pendingEvaluation.valid())
+		m_pendingEvaluation.wait();
+	m_snapshot.reset(); // recreated with the new seed
 }
 
 size_t Network::evaluate(const std::vector<Sample>& testSamples,
 		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare) {
+	Profiler::Scope scope{m_profiler, Profiler::evaluate};
 	size_t correct = 0;
+	std::vector<flt_t> expectedOutputs; // for the samples that only have the expected class
+	std::vector<flt_t> actualOutputs(outputCount()); // reused, so that no sample allocates
 	for(auto&& sample : testSamples) {
-		std::vector<flt_t> actualOutputs = calculate(sample.getInputs());
-		correct += compare(sample.getExpectedOutputs(), actualOutputs);
+		calculate(sample, actualOutputs.data());
+		if (sample.hasOnlyExpectedClass()) {
+			expectedOutputs.assign(actualOutputs.size(), 0.0);
+			expectedOutputs.at(sample.getExpectedClass()) = 1.0;
+			correct += compare(expectedOutputs, actualOutputs);
+		} else {
+			correct += compare(sample.getExpectedOutputs(), actualOutputs);
+		}
+	}
+	return correct;
+}
+
+size_t Network::evaluate(SampleSource& testSamples,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare) {
+	size_t correct = 0;
+	std::vector<Sample> batch;
+	testSamples.rewind(evaluationBatchSize);
+	while(testSamples.nextBatch(batch)) {
+		correct += evaluate(batch, compare);
 	}
 	return correct;
 }
 
 flt_t Network::cost(const std::vector<Sample>& samples, const flt_t regularizationParameter) {
+	Profiler::Scope scope{m_profiler, Profiler::cost};
 	/*
 		          1	     |--                                                  regularizationParameter                                        --|
 		cost  =  ---  *  |  accumulateForEverySample( m_costFunction() )  +  ------------------------- * accumulateForEveryWeight( weight^2 )  |
@@ -228,59 +894,166 @@ flt_t Network::cost(const std::vector<Sample>& samples, const flt_t regularizati
 
 	flt_t cost0Acc = 0.0;
 	for(auto&& sample : samples) {
-		feedforward(sample.getInputs());
+		feedforward(sample);
 
 		// cost for this set of inputs
 		for(size_t y = 0; y != m_nodes.back().size(); ++y) {
-			cost0Acc += m_costFunction(m_nodes.back()[y].a, sample.getExpectedOutputs()[y]);
+			cost0Acc += m_costFunction(m_nodes.back().a[y], sample.getExpectedOutput(y));
 		}
 	}
 
+	foldWeightScales();
 	flt_t weightCostAcc = 0.0;
 	for(size_t x = 1; x != m_nodes.size(); ++x) {
-		for(auto&& node : m_nodes[x])
-			for(auto&& weight : node.weights)
-				weightCostAcc += weight * weight;
+		weightCostAcc += m_layers[x]->squaredWeightSum();
 	}
 
 	return (cost0Acc + 0.5 * regularizationParameter * weightCostAcc) / samples.size();
 }
 
+flt_t Network::cost(SampleSource& samples, const flt_t regularizationParameter) {
+	// the cost of every batch is an average: weight it by the batch size, and
+	// add the regularization term (which does not depend on the samples) only once
+	flt_t costAcc = 0.0;
+	std::vector<Sample> batch;
+	samples.rewind(evaluationBatchSize);
+	while(samples.nextBatch(batch)) {
+		costAcc += cost(batch, 0.0) * batch.size();
+	}
+
+	foldWeightScales();
+	flt_t weightCostAcc = 0.0;
+	for(size_t x = 1; x != m_nodes.size(); ++x) {
+		weightCostAcc += m_layers[x]->squaredWeightSum();
+	}
+
+	return (costAcc + 0.5 * regularizationParameter * weightCostAcc) / samples.size();
+}
+
+void Network::setProfiling(const bool enabled) {
+	m_profiler.setEnabled(enabled);
+}
+
+void Network::writeCheckpoint(const std::string& filename, TrainingObserver& observer, const size_t epoch) {
+	foldWeightScales();
+	std::ofstream file{filename};
+	file.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+	file << *this;
+	file.close();
+	observer.onCheckpoint({epoch, filename});
+}
+
+void Network::setRecomputation(const bool enabled) {
+	m_recomputation = enabled;
+	for(auto&& layer : m_layers) {
+		if (layer)
+			layer->setRecomputation(enabled);
+	}
+}
+
+size_t Network::activationBytes() const {
+	size_t bytes = m_layerBuffer.capacity() * sizeof(flt_t);
+	for(size_t x = 0; x != m_nodes.size(); ++x) {
+		const Nodes& nodes = m_nodes[x];
+		bytes += (nodes.z.capacity() + nodes.a.capacity() + nodes.error.capacity()) * sizeof(flt_t);
+		if (m_layers[x])
+			bytes += m_layers[x]->activationBytes();
+	}
+	if (m_recomputation)
+		bytes += Layer::sharedActivationBytes();
+	return bytes;
+}
+
+bool Network::setPerfCounters(const bool enabled) {
+	if (enabled)
+		m_profiler.setEnabled(true);
+	return m_profiler.setCounting(enabled);
+}
+
+double Network::trainingFlops(const size_t samples, const size_t miniBatchSize) const {
+	// multiplications and additions in the inner loops of feedforward,
+	// backpropagation and momentumSGDMiniBatch, ignoring activation functions
+	// (convolutions share their weights, so they have fewer parameters than connections)
+	double connections = 0, hiddenConnections = 0, parameters = 0;
+	for(size_t x = 1; x != m_nodes.size(); ++x) {
+		const double layerConnections = m_layers[x]->multiplyAdds();
+		connections += layerConnections;
+		if (x != 1)
+			hiddenConnections += layerConnections;
+		parameters += m_layers[x]->weightCount();
+	}
+
+	const double perSample = 2*connections // forward
+		+ 3*hiddenConnections + 2*connections; // backward: error and accumulated weights nabla
+	const double perMiniBatch = 6*parameters; // velocities and weights update
+	const double miniBatches = std::ceil((double)samples / std::max<size_t>(1, miniBatchSize));
+	return perSample * samples + perMiniBatch * miniBatches;
+}
+
 std::istream& operator>>(std::istream& in, Network& network) {
+	// the original format starts directly with the number of layers
+	bool hasActivationFunctions = false, hasKinds = false;
+	if (!std::isdigit((in >> std::ws).peek())) {
+		std::string format;
+		in >> format;
+		if (format != "nn-v2" && format != "nn-v3")
+			throw std::runtime_error{"Unknown network format " + format};
+		hasActivationFunctions = true;
+		hasKinds = format == "nn-v3";
+	}
+
 	size_t xSize;
 	in >> xSize;
-	network.m_nodes.resize(xSize, std::vector<Node>{});
+	network.m_nodes.assign(xSize, Nodes{});
+	network.m_activationFunctions.assign(xSize, &network.m_activationFunction);
+	network.m_activationFunctions[0] = nullptr;
+	network.m_layers.clear();
+	network.m_layers.resize(xSize);
+	network.m_activeInputs.clear();
 
 	// input layer has no parameter
 	size_t ySize;
 	in >> ySize;
-	for(size_t y = 0; y != ySize; ++y) {
-		// inputs have no input-connections
-		network.m_nodes[0].push_back(Node{0});
-	}
+	network.m_nodes[0] = Nodes(ySize);
+	network.m_activeInputs.reserve(ySize);
 
 	for(size_t x = 1; x != xSize; ++x) {
 		in >> ySize;
-		for(size_t y = 0; y != ySize; ++y) {
-			network.m_nodes[x].push_back(Node{0});
-			in >> network.m_nodes[x].back();
+		if (hasActivationFunctions) {
+			std::string name;
+			in >> name;
+			network.m_activationFunctions[x] = activationFunctionByName(name);
+			if (network.m_activationFunctions[x] == nullptr)
+				throw std::runtime_error{"Unknown activation function " + name};
 		}
+		// the older formats only have dense layers
+		std::string kind = "dense";
+		if (hasKinds)
+			in >> kind;
+		network.m_layers[x] = readLayer(in, kind, network.m_nodes[x-1].size(), ySize);
+		if (!network.m_layers[x])
+			throw std::runtime_error{"Unknown layer kind " + kind};
+		network.m_layers[x]->setRecomputation(network.m_recomputation);
+		if (network.m_layers[x]->inputSize() != network.m_nodes[x-1].size()
+				|| network.m_layers[x]->outputSize() != ySize)
+			throw std::runtime_error{"The " + kind + " layer " + std::to_string(x)
+				+ " does not match the sizes of the layers"};
+		network.m_nodes[x] = Nodes(ySize);
 	}
 
+	network.checkActivationFunctions();
 	return in;
 }
 
 std::ostream& operator<<(std::ostream& out, const Network& network) {
-	out << network.m_nodes.size() << " ";
+	out << "nn-v3 " << network.m_nodes.size() << " ";
 
 	// input layer has no parameter
 	out << network.m_nodes[0].size() << " ";
 
 	for(size_t x = 1; x != network.m_nodes.size(); ++x) {
-		out << network.m_nodes[x].size() << " ";
-		for(size_t y = 0; y != network.m_nodes[x].size(); ++y) {
-			out << network.m_nodes[x][y];
-		}
+		out << network.m_nodes[x].size() << " " << network.m_activationFunctions[x]->name() << " "
+			<< *network.m_layers[x];
 	}
 
 	return out;
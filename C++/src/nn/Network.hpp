@@ -5,10 +5,23 @@
 #include <istream>
 #include <ostream>
 #include <functional>
+#include <random>
+#include <memory>
+#include <future>
 #include "utils.hpp"
+#include "Aligned.hpp"
 #include "Node.hpp"
 #include "Sample.hpp"
+#include "SampleSource.hpp"
 #include "CostFunction.hpp"
+#include "Layer.hpp"
+#include "Dense.hpp"
+#include "Convolution.hpp"
+#include "Pooling.hpp"
+#include "Profiler.hpp"
+#include "Telemetry.hpp"
+#include "EvaluationSchedule.hpp"
+#include "ThreadPool.hpp"
 
 namespace nn {
 
@@ -21,17 +34,66 @@ class Network { public: // TODO
 	   | y
 	   v
 	*/
-	std::vector<std::vector<Node>> m_nodes; // m_nodes[x][y] to access a node
+	// m_nodes[x].a[y] to access the activation of a node; those of the input
+	// layer are all the inputs of the last feedforward, also when only the
+	// active ones changed
+	std::vector<Nodes> m_nodes;
 
-	ActivationFunction& m_activationFunction;
+	ActivationFunction& m_activationFunction; // of the layers that were not given their own
+	std::vector<ActivationFunction*> m_activationFunctions; // of every layer, nullptr for the input layer
+	std::vector<std::unique_ptr<Layer>> m_layers; // the parameters and the computation of every layer, nullptr for the input layer
 	CostFunction& m_costFunction;
 
+	// the derivatives of the activation function of a layer in backpropagation
+	AlignedVector<flt_t> m_layerBuffer;
+	bool m_recomputation; // @see setRecomputation
+
+	// indices of the nonzero inputs of the last feedforward; if there are few
+	// of them the first layer only multiplies and updates their weights
+	std::vector<uint32_t> m_activeInputs;
+	bool m_sparseInputs;
+
+	bool m_lazyWeightDecay; // @see setLazyWeightDecay
+
+	Profiler m_profiler; // disabled by default, @see setProfiling
+
+	EvaluationSchedule m_evaluationSchedule; // @see setEvaluationSchedule
+	std::mt19937 m_evaluationEngine; // draws validation subsets
+
+	// copy of the parameters evaluated in the background, @see EvaluationSchedule::background
+	std::unique_ptr<Network> m_snapshot;
+	std::future<EvaluationEvent> m_pendingEvaluation;
+
+	// accumulated by backpropagation from the outputs it computes anyway,
+	// reset at the start of every epoch
+	struct TrainingStatistics {
+		double cost; // sum over samples, without regularization
+		size_t samples;
+		size_t correct, classified; // @see EpochEndEvent::trainingCorrect
+	} m_trainingStatistics;
+
+	// the threads of calculateBatch, started by its first call with several
+	std::unique_ptr<ThreadPool> m_threadPool;
+
 	/**
 	 * @brief calculates the value of the output nodes based on the inputs
 	 * @param inputs array of inputs of the same length as the first layer of the network
 	 */
 	void feedforward(const std::vector<flt_t>& inputs);
 
+	/**
+	 * @brief calculates the value of the output nodes based on the inputs of
+	 *   a sample, using its nonzero inputs if they were computed
+	 * @see Sample::computeNonzeroInputs
+	 */
+	void feedforward(const Sample& sample);
+
+	/**
+	 * @brief calculates the value of the output nodes after the inputs and the
+	 *   active inputs have been set
+	 */
+	void feedforwardLayers();
+
 	/**
 	 * @brief trains the network to better perform with the provided samples using
 	 *   the average of the nabla's of all samples and the "velocity" of every node
@@ -51,10 +113,38 @@ class Network { public: // TODO
 
 	/**
 	 * @brief calculates the bias' nabla and the weights' nabla of the sample
+	 *   and adds them to the accumulated ones of the mini batch, and adds its
+	 *   cost and whether it was classified correctly to the training statistics
 	 * @param sample the sample containing the expected outputs for the inputs
 	 */
 	void backpropagation(const Sample& sample);
 
+	/**
+	 * @brief accumulates the gradients of the parameters of a layer, whose
+	 *   errors are known, and propagates them to the errors of the previous
+	 *   layer, which are then still to be multiplied by its derivatives
+	 */
+	void backpropagateLayer(const size_t layer);
+
+	/**
+	 * @brief sets the velocities and the accumulated nablas of all parameters
+	 *   to 0, at the start of every epoch (momentumSGDMiniBatch then resets the
+	 *   accumulated nablas when it applies them)
+	 */
+	void resetOptimizer();
+
+	/**
+	 * @brief starts scaling the weights of the epoch instead of decaying
+	 *   them, if lazy weight decay is enabled
+	 * @see setLazyWeightDecay
+	 */
+	void startLazyWeightDecay(const flt_t weightDecayFactor, const flt_t momentumCoefficient);
+
+	/**
+	 * @brief folds the weight scales at the end of an epoch, and stops
+	 *   scaling the weights
+	 */
+	void stopLazyWeightDecay();
 
 	/**
 	 * @brief applies the momentum-based stochastic-gradient-descent learning algorithm
@@ -67,13 +157,124 @@ class Network { public: // TODO
 	 *   becoming big. Set to 0 if no regularization is wanted.
 	 * @param momentumCoefficient factor to scale the "velocity" of the parameter by,
 	 *   every iteration. Set to 0 to run exactly as standard stochastic-gradient-descent.
+	 * @param afterMiniBatch if set, called after every mini batch with the index
+	 *   of the mini batch in the epoch and the number of samples in it
 	 * @see stochasticGradientDescent
+	 * @see m_trainingStatistics
 	 */
 	void momentumSGDEpoch(std::vector<Sample>& trainingSamples,
 		const size_t miniBatchSize,
 		const flt_t eta,
 		const flt_t regularizationParameter,
-		const flt_t momentumCoefficient);
+		const flt_t momentumCoefficient,
+		const std::function<void(const size_t, const size_t)>& afterMiniBatch = {});
+
+	/**
+	 * @brief applies the momentum-based stochastic-gradient-descent learning algorithm
+	 *   (only for one epoch) on samples retrieved from a source
+	 * @param trainingSamples the source of the samples to train on; it takes care
+	 *   of shuffling them
+	 * @see momentumSGDEpoch
+	 */
+	void momentumSGDEpoch(SampleSource& trainingSamples,
+		const size_t miniBatchSize,
+		const flt_t eta,
+		const flt_t regularizationParameter,
+		const flt_t momentumCoefficient,
+		const std::function<void(const size_t, const size_t)>& afterMiniBatch = {});
+
+	/**
+	 * @brief runs the epochs of momentumSGD, notifying the observer of the
+	 *   training progress, of the evaluation after every epoch and of the
+	 *   throughput and (if profiling is enabled) the time of every phase
+	 * @param trainingSamples either a `std::vector<Sample>` or a SampleSource
+	 * @param testSamples either a `std::vector<Sample>` or a SampleSource
+	 * @see momentumSGD
+	 */
+	template<class TrainingSamples, class TestSamples>
+	void runMomentumSGD(TrainingSamples& trainingSamples,
+		const size_t epochs,
+		const size_t miniBatchSize,
+		const flt_t eta,
+		const flt_t regularizationParameter,
+		const flt_t momentumCoefficient,
+		TestSamples& testSamples,
+		TrainingObserver& observer,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare);
+
+	/**
+	 * @brief draws a random subset of the test samples
+	 * @param size the size of the subset
+	 * @see EvaluationSchedule::subsetSize
+	 */
+	std::vector<Sample> validationSubset(const std::vector<Sample>& testSamples, const size_t size);
+	std::vector<Sample> validationSubset(SampleSource& testSamples, const size_t size);
+
+	/**
+	 * @brief the floating point operations needed to train for an epoch
+	 *   (computed from the topology)
+	 * @param samples the number of training samples in the epoch
+	 * @param miniBatchSize size of the batch of samples to use for the gradient descent
+	 */
+	double trainingFlops(const size_t samples, const size_t miniBatchSize) const;
+
+	/**
+	 * @brief evaluates the accuracy and the cost of the network on the test
+	 *   samples, or on a subset of them, according to the evaluation schedule
+	 * @param epoch the current epoch, or 0 if training has not started
+	 * @param epochs the total number of epochs
+	 * @param miniBatch the mini batches done in the current epoch, or 0 at its end
+	 * @param testSamples either a `std::vector<Sample>` or a SampleSource
+	 * @see setEvaluationSchedule
+	 */
+	template<class TestSamples>
+	EvaluationEvent evaluation(const size_t epoch,
+		const size_t epochs,
+		const size_t miniBatch,
+		TestSamples& testSamples,
+		const flt_t regularizationParameter,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare);
+
+	/**
+	 * @brief evaluates the network and notifies the observer of the results,
+	 *   or starts evaluating a snapshot of it in the background
+	 * @param observer the observer to notify
+	 * @see evaluation
+	 * @see momentumSGD
+	 */
+	template<class TestSamples>
+	void evaluateAndNotify(TrainingObserver& observer,
+		const size_t epoch,
+		const size_t epochs,
+		const size_t miniBatch,
+		TestSamples& testSamples,
+		const flt_t regularizationParameter,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare);
+
+	/**
+	 * @brief notifies the observer of the results of the background evaluation
+	 *   if there is one and it is done
+	 * @param wait whether to wait for the background evaluation to be done
+	 */
+	void notifyBackgroundEvaluation(TrainingObserver& observer, const bool wait);
+
+	/**
+	 * @brief throws if an activation function that is not elementwise (e.g.
+	 *   softmax) is not used for the output layer, or is used with a cost
+	 *   function that does not support it
+	 */
+	void checkActivationFunctions() const;
+
+	/**
+	 * @brief copies the current parameters to the snapshot evaluated in the
+	 *   background, reusing its memory if the topology did not change
+	 */
+	void updateSnapshot();
+
+	/**
+	 * @return the layer if it is fully-connected, nullptr otherwise
+	 */
+	DenseLayer* denseLayer(const size_t layer) const;
 
 public:
 	/**
@@ -87,6 +288,15 @@ public:
 		ActivationFunction& activationFunction,
 		CostFunction& costFunction);
 
+	/**
+	 * @brief constructs a fully-connected neural network whose dimensions are
+	 *   only known at runtime
+	 * @see Network(const std::initializer_list<size_t>&, ActivationFunction&, CostFunction&)
+	 */
+	Network(const std::vector<size_t>& dimensions,
+		ActivationFunction& activationFunction,
+		CostFunction& costFunction);
+
 	/**
 	 * @brief constructs an empty neural network
 	 * @param activationFunction @see nn::ActivationFunction class
@@ -95,6 +305,86 @@ public:
 	 */
 	Network(ActivationFunction& activationFunction, CostFunction& costFunction);
 
+	/**
+	 * @brief constructs a fully-connected neural network with a different
+	 *   activation function for every layer, e.g. rectifiedLinear for the
+	 *   hidden layers and sigmoid for the output layer
+	 * @param dimensions the length of every layer of nodes
+	 * @param activationFunctions the activation function of every layer but
+	 *   the input layer; the last one is also used for layers read from
+	 *   model files that do not specify theirs
+	 * @param costFunction @see nn::CostFunction class
+	 */
+	Network(const std::vector<size_t>& dimensions,
+		const std::vector<ActivationFunction*>& activationFunctions,
+		CostFunction& costFunction);
+
+	/**
+	 * @brief constructs a neural network that mixes fully-connected layers with
+	 *   other kinds of Layer, e.g. Conv2D and MaxPool2D layers that encode
+	 *   images and ConvTranspose2D layers that decode them
+	 * @param dimensions the length of every layer of nodes, which must be the
+	 *   output size of the Layer of the layer, if any
+	 * @param activationFunctions the activation function of every layer but the input layer
+	 * @param layers the Layer of every layer but the input layer, or nullptr
+	 *   for fully-connected layers; they are copied, with new random parameters
+	 * @param costFunction @see nn::CostFunction class
+	 */
+	Network(const std::vector<size_t>& dimensions,
+		const std::vector<ActivationFunction*>& activationFunctions,
+		const std::vector<const Layer*>& layers,
+		CostFunction& costFunction);
+
+	/**
+	 * @brief changes the activation function of a layer, keeping its parameters
+	 * @param layer the index of the layer, from 1 (the first layer after the inputs)
+	 * @param activationFunction @see nn::ActivationFunction class
+	 */
+	void setActivationFunction(const size_t layer, ActivationFunction& activationFunction);
+
+	/**
+	 * @brief sets to 0 the weights with the smallest magnitude of every
+	 *   fully-connected layer, and keeps them at 0 in further training, which
+	 *   fine-tunes the others
+	 * @param sparsity the fraction of the weights of every layer to prune, in
+	 *   [0, 1]; weights pruned before count toward it
+	 * @see SparseNetwork
+	 */
+	void pruneByMagnitude(const flt_t sparsity);
+
+	/**
+	 * @brief keeps only the k weights with the largest magnitude of every node,
+	 *   and sets the others to 0, also in further training
+	 * @param k how many weights of every node to keep
+	 * @see pruneByMagnitude
+	 */
+	void pruneTopK(const size_t k);
+
+	/**
+	 * @brief lets further training change the pruned weights again; they
+	 *   stay 0 until then
+	 */
+	void clearPruningMask();
+
+	/**
+	 * @return how many weights are pruned
+	 */
+	size_t prunedWeightCount() const;
+
+	/**
+	 * @brief replaces the weights of a layer with their best approximation of a
+	 *   lower rank, found with a truncated SVD, stored as a new linear layer of
+	 *   rank nodes followed by the layer with rank inputs. It takes
+	 *   rank * (inputs + outputs) weights instead of inputs * outputs, and
+	 *   as many fewer operations; a short training usually recovers most of
+	 *   the lost accuracy. The pruning mask of the layer is cleared.
+	 * @param layer the index of the layer, from 1 (the first layer after the
+	 *   inputs), which must be fully-connected
+	 * @param rank the number of nodes of the new layer, at most the smaller
+	 *   between the inputs and the outputs of the layer
+	 */
+	void factorizeLayer(const size_t layer, const size_t rank);
+
 	/**
 	 * @brief calculates the output of the network based on the provided inputs
 	 * @param inputs array of inputs of the same length as the first layer of the network
@@ -102,6 +392,82 @@ public:
 	 */
 	std::vector<flt_t> calculate(const std::vector<flt_t>& inputs);
 
+	/**
+	 * @brief calculates the output of the network based on the inputs of a
+	 *   sample, which may be sparse
+	 * @param sample the sample whose inputs to use; its expected outputs are ignored
+	 * @return the values of the output nodes
+	 */
+	std::vector<flt_t> calculate(const Sample& sample);
+
+	/**
+	 * @brief calculates the output of the network without allocating memory,
+	 *   once the buffers of the network have grown to the size of its layers
+	 *   (i.e. after its first use)
+	 * @param inputs array of inputs of the same length as the first layer of the network
+	 * @param outputs where to write the values of the output nodes, outputCount() of them
+	 */
+	void calculate(const std::vector<flt_t>& inputs, flt_t* outputs);
+
+	/**
+	 * @brief calculates the output of the network based on the inputs of a
+	 *   sample without allocating memory
+	 * @see calculate(const std::vector<flt_t>&, flt_t*)
+	 */
+	void calculate(const Sample& sample, flt_t* outputs);
+
+	/**
+	 * @brief calculates the output of the network without allocating nor
+	 *   copying it: it stays in a buffer of the network
+	 * @param inputs array of inputs of the same length as the first layer of the network
+	 * @return the values of the output nodes, outputCount() of them, valid
+	 *   until the network is used again
+	 */
+	const flt_t* calculateView(const std::vector<flt_t>& inputs);
+
+	/**
+	 * @brief calculates the output of the network based on the inputs of a
+	 *   sample without allocating nor copying it
+	 * @see calculateView(const std::vector<flt_t>&)
+	 */
+	const flt_t* calculateView(const Sample& sample);
+
+	/**
+	 * @return the number of output nodes
+	 */
+	size_t outputCount() const;
+
+	/**
+	 * @brief calculates the outputs of a batch of inputs at once: every layer
+	 *   multiplies the activations of many samples by its weights (the
+	 *   batched forward pass of its Layer, with gemm), which reads every weight
+	 *   from memory once for all of them instead of once per sample. The
+	 *   batch is split in tiles of samples, computed by up to `threads` threads
+	 *   which share the layers (@see Layer::infer) and are kept for the next call.
+	 * @param inputs batchSize rows of as many inputs as the first layer of the
+	 *   network, one after the other
+	 * @param batchSize the number of samples
+	 * @param outputs where to write batchSize rows of outputCount() values
+	 * @param threads the maximum number of threads, including the calling one
+	 */
+	void calculateBatch(const flt_t* inputs, const size_t batchSize, flt_t* outputs, const size_t threads = 1);
+
+	/**
+	 * @brief calculates the outputs of a batch of inputs at once
+	 * @param inputs the rows of inputs of every sample, one after the other
+	 * @return the rows of outputs of every sample, one after the other
+	 * @see calculateBatch(const flt_t*, const size_t, flt_t*, const size_t)
+	 */
+	std::vector<flt_t> calculateBatch(const std::vector<flt_t>& inputs, const size_t threads = 1);
+
+	/**
+	 * @brief calculates the outputs of the inputs of a batch of samples at
+	 *   once; their expected outputs are ignored, and they may be sparse
+	 * @return the rows of outputs of every sample, one after the other
+	 * @see calculateBatch(const flt_t*, const size_t, flt_t*, const size_t)
+	 */
+	std::vector<flt_t> calculateBatch(const std::vector<Sample>& samples, const size_t threads = 1);
+
 	/**
 	 * @brief the cost function over all samples and weights
 	 * @param samples the samples on which to calculate the cost
@@ -112,6 +478,13 @@ public:
 	 */
 	flt_t cost(const std::vector<Sample>& samples, const flt_t regularizationParameter);
 
+	/**
+	 * @brief the cost function over all samples of a source and all weights,
+	 *   retrieving the samples one batch at a time
+	 * @see cost
+	 */
+	flt_t cost(SampleSource& samples, const flt_t regularizationParameter);
+
 	/**
 	 * @brief applies the stochastic-gradient-descent learning algorithm,
 	 *   while also printing network statistics after every epoch
@@ -168,6 +541,79 @@ public:
 		const std::vector<Sample>& testSamples,
 		std::ostream& out,
 		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare);
+
+	/**
+	 * @brief applies the momentum-based stochastic-gradient-descent learning algorithm
+	 *   on samples produced on the fly by a source (e.g. augmented or streamed from disk),
+	 *   while also printing network statistics after every epoch
+	 * @param trainingSamples the source of the samples to train on
+	 * @see momentumSGD
+	 */
+	void momentumSGD(SampleSource& trainingSamples,
+		const size_t epochs,
+		const size_t miniBatchSize,
+		const flt_t eta,
+		const flt_t regularizationParameter,
+		const flt_t momentumCoefficient,
+		const std::vector<Sample>& testSamples,
+		std::ostream& out,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare);
+
+	/**
+	 * @brief applies the momentum-based stochastic-gradient-descent learning algorithm
+	 *   on samples streamed from a source, while also printing network statistics
+	 *   after every epoch, evaluated on test samples that are streamed too
+	 * @param trainingSamples the source of the samples to train on
+	 * @param testSamples the source of the samples to use for testing
+	 * @see momentumSGD
+	 */
+	void momentumSGD(SampleSource& trainingSamples,
+		const size_t epochs,
+		const size_t miniBatchSize,
+		const flt_t eta,
+		const flt_t regularizationParameter,
+		const flt_t momentumCoefficient,
+		SampleSource& testSamples,
+		std::ostream& out,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare);
+
+	/**
+	 * @brief applies the momentum-based stochastic-gradient-descent learning algorithm,
+	 *   reporting structured events about the training progress to an observer
+	 *   instead of printing them. Use StreamPrinter to get the same output as
+	 *   the overloads taking an output stream, or e.g. a JsonLinesSink.
+	 * @param observer notified when epochs start and end, after every mini
+	 *   batch, and of every evaluation of the test samples
+	 * @see momentumSGD
+	 * @see TrainingObserver
+	 */
+	void momentumSGD(std::vector<Sample> trainingSamples,
+		const size_t epochs,
+		const size_t miniBatchSize,
+		const flt_t eta,
+		const flt_t regularizationParameter,
+		const flt_t momentumCoefficient,
+		const std::vector<Sample>& testSamples,
+		TrainingObserver& observer,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare);
+	void momentumSGD(SampleSource& trainingSamples,
+		const size_t epochs,
+		const size_t miniBatchSize,
+		const flt_t eta,
+		const flt_t regularizationParameter,
+		const flt_t momentumCoefficient,
+		const std::vector<Sample>& testSamples,
+		TrainingObserver& observer,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare);
+	void momentumSGD(SampleSource& trainingSamples,
+		const size_t epochs,
+		const size_t miniBatchSize,
+		const flt_t eta,
+		const flt_t regularizationParameter,
+		const flt_t momentumCoefficient,
+		SampleSource& testSamples,
+		TrainingObserver& observer,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare);
 	
 	/**
 	 * @brief calculates how many test samples are correctly recognized by the network
@@ -179,9 +625,102 @@ public:
 	 */
 	size_t evaluate(const std::vector<Sample>& testSamples,
 		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare);
+
+	/**
+	 * @brief calculates how many test samples are correctly recognized by the network,
+	 *   retrieving them from a source one batch at a time
+	 * @see evaluate
+	 */
+	size_t evaluate(SampleSource& testSamples,
+		std::function<bool(const std::vector<flt_t>&, const std::vector<flt_t>&)> compare);
 	
 	/**
-	 * @brief read network parameters from an input stream
+	 * @brief writes the network parameters to a file and notifies the observer
+	 * @param filename the file to write
+	 * @param observer the observer to notify of the checkpoint
+	 * @param epoch the epoch after which the checkpoint is written, for the observer
+	 */
+	void writeCheckpoint(const std::string& filename, TrainingObserver& observer, const size_t epoch = 0);
+
+	/**
+	 * @brief sets when momentumSGD evaluates the network and whether it does so on
+	 *   all test samples or on a random subset of them, which is much cheaper
+	 *   and comes with a confidence interval for the accuracy
+	 * @param schedule the evaluation schedule; its seed also resets the
+	 *   generator of the subsets
+	 */
+	void setEvaluationSchedule(const EvaluationSchedule& schedule);
+
+	/**
+	 * @brief enables or disables timing the phases of training and evaluation;
+	 *   when enabled, momentumSGD also reports the time of every phase after every
+	 *   epoch. Has no effect if compiled with NN_PROFILING=0.
+	 * @param enabled whether to profile
+	 */
+	void setProfiling(const bool enabled);
+
+	/**
+	 * @brief enables or disables sampling hardware performance counters (cycles,
+	 *   instructions, L1 and LLC misses, branch misses) in every profiled phase,
+	 *   reported after every epoch together with the profiling statistics.
+	 *   Must be called from the thread that then trains the network.
+	 * @param enabled whether to sample the counters; also enables profiling
+	 * @return `false` if no counter is available (e.g. not Linux, missing
+	 *   permissions, or virtualized CPU), in which case only timing is profiled
+	 * @see setProfiling
+	 */
+	bool setPerfCounters(const bool enabled);
+
+	/**
+	 * @brief enables or disables recomputing, during the backward pass, what
+	 *   every Layer needs from its forward pass (e.g. the im2col matrices of
+	 *   convolutions), instead of keeping it for every layer. Layers then share
+	 *   the largest of those buffers, which trades some time for the memory of
+	 *   all the others; momentumSGD reports both after every epoch.
+	 *   Fully-connected layers keep nothing but the activations of their
+	 *   nodes, which backpropagation needs anyway.
+	 * @param enabled whether to recompute
+	 * @see activationBytes
+	 */
+	void setRecomputation(const bool enabled);
+
+	/**
+	 * @return the bytes of activations kept between the forward and the
+	 *   backward pass: z, a and the error of every node, and the buffers of
+	 *   every Layer, at their largest size so far
+	 */
+	size_t activationBytes() const;
+
+	/**
+	 * @brief enables or disables lazy weight decay: instead of multiplying every
+	 *   weight by the weight decay factor after every mini batch, momentumSGD
+	 *   multiplies a scale of every fully-connected layer (@see DenseLayer),
+	 *   and folds it into the weights at the end of the epoch, or when it
+	 *   becomes too small.
+	 *   Mini batches of sparse samples then only update the weights of their
+	 *   nonzero inputs; the others catch up the missed mini batches (their
+	 *   decay and momentum) at once, when they are next used. The results
+	 *   are the same, but for rounding.
+	 * @param enabled whether to decay the weights lazily
+	 * @see foldWeightScales
+	 */
+	void setLazyWeightDecay(const bool enabled);
+
+	/**
+	 * @brief brings the weights up to date during an epoch with lazy weight
+	 *   decay, e.g. before reading, changing or writing them with operator<<
+	 *   in a callback after a mini batch; does nothing otherwise. The network does it
+	 *   itself whenever it needs them, e.g. to save or to prune them.
+	 * @see setLazyWeightDecay
+	 */
+	void foldWeightScales();
+
+	/**
+	 * @brief read network parameters from an input stream, either in the current
+	 *   format, which starts with "nn-v3" and contains the activation function
+	 *   and the kind ("dense" or the name of a Layer) of every layer, in
+	 *   the "nn-v2" one, whose layers are all dense, or in the original one, in
+	 *   which case all layers use the activation function passed to the constructor
 	 * @param in input stream
 	 * @param network the network to save the parameters in
 	 * @return in
@@ -1,34 +1,25 @@
 #ifndef _NN_NODE_HPP_
 #define _NN_NODE_HPP_
 
-#include <vector>
-#include <istream>
-#include <ostream>
 #include "utils.hpp"
+#include "Aligned.hpp"
 
 namespace nn {
 
-struct Node {
-	flt_t bias;
-	std::vector<flt_t> weights;
+// the nodes of a layer, one array for every value of theirs, so that the
+// Layers read and write them in place; the parameters belong to the Layer
+struct Nodes {
+	PaddedVector<flt_t> z, a; // a = f(z), the inputs for the input layer
+	PaddedVector<flt_t> error; // == biasNabla
 
-	flt_t z, a; // a = sigmoid(z)
+	Nodes() = default;
 
-	flt_t error; // == biasNabla
-	std::vector<flt_t> weightsNabla;
+	explicit Nodes(const size_t size) :
+			z(size), a(size), error(size) {}
 
-	// accumulated nablas
-	flt_t accBiasNabla;
-	std::vector<flt_t> accWeightsNabla; // remove this?
-
-	// velocities
-	flt_t biasVelocity;
-	std::vector<flt_t> weightsVelocity;
-
-	Node(const size_t inputCount);
-
-	friend std::istream& operator>>(std::istream& in, Node& node);
-	friend std::ostream& operator<<(std::ostream& out, const Node& node);
+	size_t size() const {
+		return a.size();
+	}
 };
 
 } /* namespace nn */
@@ -0,0 +1,51 @@
+#include "Optimizer.hpp"
+#include "Aligned.hpp"
+
+namespace nn {
+
+void momentumUpdate(const size_t count,
+		const flt_t etaScaled,
+		const flt_t weightDecayFactor,
+		const flt_t momentumCoefficient,
+		flt_t* parameters,
+		flt_t* velocities,
+		flt_t* gradients,
+		const flt_t* mask) {
+	parameters = assumeAligned(parameters);
+	velocities = assumeAligned(velocities);
+	gradients = assumeAligned(gradients);
+	// two loops, so that neither has a branch in its body
+	if (mask == nullptr) {
+		for(size_t i = 0; i != count; ++i) {
+			const flt_t velocity = momentumCoefficient * velocities[i] - etaScaled * gradients[i];
+			velocities[i] = velocity;
+			parameters[i] = weightDecayFactor * parameters[i] + velocity;
+			gradients[i] = 0;
+		}
+	} else {
+		for(size_t i = 0; i != count; ++i) {
+			const flt_t velocity = momentumCoefficient * velocities[i] - etaScaled * gradients[i];
+			velocities[i] = velocity;
+			parameters[i] = (weightDecayFactor * parameters[i] + velocity) * assumeAligned(mask)[i];
+			gradients[i] = 0;
+		}
+	}
+}
+
+void momentumUpdate(const std::vector<uint32_t>& indices,
+		const flt_t etaScaled,
+		const flt_t weightDecayFactor,
+		const flt_t momentumCoefficient,
+		flt_t* parameters,
+		flt_t* velocities,
+		flt_t* gradients,
+		const flt_t* mask) {
+	for(auto&& i : indices) {
+		const flt_t velocity = momentumCoefficient * velocities[i] - etaScaled * gradients[i];
+		velocities[i] = velocity;
+		parameters[i] = (weightDecayFactor * parameters[i] + velocity) * (mask ? mask[i] : 1);
+		gradients[i] = 0;
+	}
+}
+
+} /* namespace nn */
@@ -0,0 +1,55 @@
+#ifndef _NN_OPTIMIZER_HPP_
+#define _NN_OPTIMIZER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "utils.hpp"
+
+namespace nn {
+
+/**
+ * @brief momentum-based gradient descent step of a row of parameters, fused in
+ *   a single sweep that reads every gradient, velocity and parameter once and
+ *   writes them once, with independent iterations that the compiler
+ *   vectorizes: the velocity becomes `momentum * velocity - eta * gradient`,
+ *   the parameter `weightDecay * parameter + velocity`, and the gradient 0,
+ *   ready to be accumulated over the next mini batch.
+ * @param count the number of parameters, e.g. the padded size of a row of weights
+ * @param etaScaled the learning rate divided by the size of the mini batch
+ * @param weightDecayFactor scales the parameters before adding the velocities, 1 for biases
+ * @param momentumCoefficient scales the previous velocities
+ * @param parameters the weights or the biases
+ * @param velocities their velocities
+ * @param gradients their gradients accumulated over the mini batch, reset to 0
+ * @param mask multiplies the parameters after the update, e.g. to keep pruned
+ *   weights at 0, or nullptr
+ * All arrays must be aligned to `alignment`, like those of AlignedVector.
+ */
+void momentumUpdate(const size_t count,
+	const flt_t etaScaled,
+	const flt_t weightDecayFactor,
+	const flt_t momentumCoefficient,
+	flt_t* parameters,
+	flt_t* velocities,
+	flt_t* gradients,
+	const flt_t* mask = nullptr);
+
+/**
+ * @brief the same step as momentumUpdate, only for some of the parameters,
+ *   e.g. the weights of the nonzero inputs of a mini batch of sparse samples
+ * @param indices the indices of the parameters to update, without duplicates
+ * @see momentumUpdate
+ */
+void momentumUpdate(const std::vector<uint32_t>& indices,
+	const flt_t etaScaled,
+	const flt_t weightDecayFactor,
+	const flt_t momentumCoefficient,
+	flt_t* parameters,
+	flt_t* velocities,
+	flt_t* gradients,
+	const flt_t* mask = nullptr);
+
+} // namespace nn
+
+#endif // _NN_OPTIMIZER_HPP_
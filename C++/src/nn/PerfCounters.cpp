@@ -0,0 +1,94 @@
+#include "PerfCounters.hpp"
+
+#ifdef __linux__
+#include <cstring>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+namespace nn {
+
+#ifdef __linux__
+
+namespace {
+	int openCounter(const uint32_t type, const uint64_t config, const int groupLeader) {
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = 0;
+		attr.exclude_kernel = 1; // allowed with the default perf_event_paranoid
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		return syscall(SYS_perf_event_open, &attr, 0 /* this thread */, -1 /* any cpu */, groupLeader, 0);
+	}
+
+	constexpr uint64_t cacheReadMisses(const uint64_t cache) {
+		return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	}
+}
+
+PerfCounters::PerfCounters() : m_leader{-1}, m_fds{}, m_groupIndex{}, m_groupSize{0} {
+	const std::pair<uint32_t, uint64_t> events[counterCount] = {
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+		{PERF_TYPE_HW_CACHE, cacheReadMisses(PERF_COUNT_HW_CACHE_L1D)},
+		{PERF_TYPE_HW_CACHE, cacheReadMisses(PERF_COUNT_HW_CACHE_LL)},
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+	};
+
+	// the first counter that can be opened becomes the group leader
+	for(size_t c = 0; c != counterCount; ++c) {
+		m_fds[c] = openCounter(events[c].first, events[c].second, m_leader);
+		if (m_fds[c] < 0) {
+			m_groupIndex[c] = unavailable;
+		} else {
+			if (m_leader < 0)
+				m_leader = m_fds[c];
+			m_groupIndex[c] = m_groupSize++;
+		}
+	}
+}
+
+PerfCounters::~PerfCounters() {
+	for(auto&& fd : m_fds)
+		if (fd >= 0)
+			::close(fd);
+}
+
+PerfCounters::Values PerfCounters::read() const {
+	Values values{};
+	if (m_leader < 0)
+		return values;
+
+	// layout of a group read: nr, time_enabled, time_running, values[nr]
+	uint64_t buffer[3 + counterCount];
+	if (::read(m_leader, buffer, sizeof(buffer)) < (ssize_t)((3 + m_groupSize) * sizeof(uint64_t)))
+		return values;
+
+	const double scale = buffer[2] == 0 ? 0.0 : (double)buffer[1] / buffer[2];
+	for(size_t c = 0; c != counterCount; ++c) {
+		if (m_groupIndex[c] != unavailable)
+			values[c] = buffer[3 + m_groupIndex[c]] * scale;
+	}
+	return values;
+}
+
+#else
+
+PerfCounters::PerfCounters() : m_leader{-1}, m_fds{}, m_groupIndex{}, m_groupSize{0} {
+	m_fds.fill(-1);
+	m_groupIndex.fill(unavailable);
+}
+
+PerfCounters::~PerfCounters() {}
+
+PerfCounters::Values PerfCounters::read() const {
+	return Values{};
+}
+
+#endif
+
+} /* namespace nn */
@@ -0,0 +1,61 @@
+#ifndef _NN_PERFCOUNTERS_HPP_
+#define _NN_PERFCOUNTERS_HPP_
+
+#include <array>
+#include <cstdint>
+#include "utils.hpp"
+
+namespace nn {
+
+/**
+ * @brief hardware performance counters of the calling thread, opened with the
+ *   Linux `perf_event_open` syscall as a single group, so that they can all be
+ *   read with one syscall. Counters that the kernel or the CPU does not provide
+ *   (e.g. in containers or VMs, or because of `perf_event_paranoid`) are just
+ *   reported as unavailable; on other platforms all of them are.
+ */
+class PerfCounters {
+public:
+	enum Counter : size_t {
+		cycles, instructions, l1dMisses, llcMisses, branchMisses,
+		counterCount,
+	};
+	static constexpr const char* counterNames[counterCount] = {
+		"cycles", "instructions", "l1d-misses", "llc-misses", "branch-misses",
+	};
+	using Values = std::array<uint64_t, counterCount>;
+
+	/**
+	 * @brief opens and starts the counters for the calling thread
+	 */
+	PerfCounters();
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	bool isAvailable(const Counter counter) const {
+		return m_groupIndex[counter] != unavailable;
+	}
+	bool isAnyAvailable() const {
+		return m_leader >= 0;
+	}
+
+	/**
+	 * @brief reads the current value of all counters, scaled to account for
+	 *   the time they were multiplexed out; unavailable counters read 0
+	 */
+	Values read() const;
+
+private:
+	static constexpr size_t unavailable = counterCount;
+
+	int m_leader;
+	std::array<int, counterCount> m_fds;
+	std::array<size_t, counterCount> m_groupIndex; // position of the counter in a group read
+	size_t m_groupSize;
+};
+
+} // namespace nn
+
+#endif // _NN_PERFCOUNTERS_HPP_
@@ -0,0 +1,162 @@
+#include "Pooling.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace nn {
+
+namespace {
+	size_t pooledSize(const size_t size, const size_t kernelSize, const size_t stride) {
+		if (kernelSize == 0 || stride == 0 || size < kernelSize)
+			throw std::runtime_error{"Invalid pooling of size " + std::to_string(size) + " with kernel "
+				+ std::to_string(kernelSize) + " and stride " + std::to_string(stride)};
+		return (size - kernelSize) / stride + 1;
+	}
+}
+
+Pooling::Pooling(const ImageShape& inputShape, const size_t kernelSize, const size_t stride) :
+		Layer{0, 0, 0},
+		m_inputShape{inputShape},
+		m_outputShape{pooledSize(inputShape.width, kernelSize, stride),
+			pooledSize(inputShape.height, kernelSize, stride), inputShape.channels},
+		m_kernelSize{kernelSize}, m_stride{stride} {}
+
+void Pooling::writeShape(std::ostream& out) const {
+	out << m_inputShape.width << " " << m_inputShape.height << " " << m_inputShape.channels << " "
+		<< m_kernelSize << " " << m_stride << " ";
+}
+
+
+MaxPool2D::MaxPool2D(const ImageShape& inputShape, const size_t kernelSize, const size_t stride) :
+		Pooling{inputShape, kernelSize, stride == 0 ? kernelSize : stride}, m_maxIndices{} {}
+
+std::unique_ptr<Layer> MaxPool2D::clone() const {
+	return std::make_unique<MaxPool2D>(*this);
+}
+
+void MaxPool2D::findMaxima(const flt_t* inputs, size_t* maxIndices) const {
+	const size_t channels = m_inputShape.channels;
+	for(size_t oy = 0; oy != m_outputShape.height; ++oy) {
+		for(size_t ox = 0; ox != m_outputShape.width; ++ox) {
+			// the first pixel of the window, then the others channel by channel
+			const size_t first = (oy * m_stride * m_inputShape.width + ox * m_stride) * channels;
+			for(size_t c = 0; c != channels; ++c)
+				maxIndices[c] = first + c;
+			for(size_t ky = 0; ky != m_kernelSize; ++ky) {
+				for(size_t kx = 0; kx != m_kernelSize; ++kx) {
+					const size_t pixel = ((oy * m_stride + ky) * m_inputShape.width + ox * m_stride + kx) * channels;
+					for(size_t c = 0; c != channels; ++c) {
+						if (inputs[pixel + c] > inputs[maxIndices[c]])
+							maxIndices[c] = pixel + c;
+					}
+				}
+			}
+			maxIndices += channels;
+		}
+	}
+}
+
+void MaxPool2D::forward(const flt_t* inputs, flt_t* z, const size_t batchSize) {
+	// when recomputing, only the indices of a sample are kept, until backward
+	if (m_recomputation && m_maxIndices.capacity() > m_outputShape.size())
+		std::vector<size_t>{}.swap(m_maxIndices);
+	m_maxIndices.resize((m_recomputation ? 1 : batchSize) * m_outputShape.size());
+	for(size_t b = 0; b != batchSize; ++b) {
+		size_t* maxIndices = m_maxIndices.data() + (m_recomputation ? 0 : b * m_outputShape.size());
+		findMaxima(inputs + b * m_inputShape.size(), maxIndices);
+		for(size_t i = 0; i != m_outputShape.size(); ++i)
+			z[b * m_outputShape.size() + i] = inputs[b * m_inputShape.size() + maxIndices[i]];
+	}
+}
+
+void MaxPool2D::infer(const flt_t* inputs, flt_t* z, const size_t batchSize) const {
+	// the maxima of findMaxima, without their indices
+	const size_t channels = m_inputShape.channels;
+	for(size_t b = 0; b != batchSize; ++b) {
+		const flt_t* image = inputs + b * m_inputShape.size();
+		for(size_t oy = 0; oy != m_outputShape.height; ++oy) {
+			for(size_t ox = 0; ox != m_outputShape.width; ++ox) {
+				std::copy_n(image + (oy * m_stride * m_inputShape.width + ox * m_stride) * channels, channels, z);
+				for(size_t ky = 0; ky != m_kernelSize; ++ky) {
+					for(size_t kx = 0; kx != m_kernelSize; ++kx) {
+						const flt_t* pixel = image + ((oy * m_stride + ky) * m_inputShape.width + ox * m_stride + kx) * channels;
+						for(size_t c = 0; c != channels; ++c) {
+							if (pixel[c] > z[c])
+								z[c] = pixel[c];
+						}
+					}
+				}
+				z += channels;
+			}
+		}
+	}
+}
+
+void MaxPool2D::backward(const flt_t* inputs, const flt_t* errors, flt_t* inputErrors, const size_t batchSize) {
+	if (inputErrors == nullptr)
+		return;
+	std::fill_n(inputErrors, batchSize * m_inputShape.size(), (flt_t)0);
+	for(size_t b = 0; b != batchSize; ++b) {
+		size_t* maxIndices = m_maxIndices.data() + (m_recomputation ? 0 : b * m_outputShape.size());
+		if (m_recomputation)
+			findMaxima(inputs + b * m_inputShape.size(), maxIndices);
+		for(size_t i = 0; i != m_outputShape.size(); ++i)
+			inputErrors[b * m_inputShape.size() + maxIndices[i]] += errors[b * m_outputShape.size() + i];
+	}
+}
+
+
+AveragePool2D::AveragePool2D(const ImageShape& inputShape, const size_t kernelSize, const size_t stride) :
+		Pooling{inputShape, kernelSize, stride == 0 ? kernelSize : stride} {}
+
+std::unique_ptr<Layer> AveragePool2D::clone() const {
+	return std::make_unique<AveragePool2D>(*this);
+}
+
+void AveragePool2D::infer(const flt_t* inputs, flt_t* z, const size_t batchSize) const {
+	const size_t channels = m_inputShape.channels;
+	const flt_t scale = (flt_t)1 / (m_kernelSize * m_kernelSize);
+	for(size_t b = 0; b != batchSize; ++b) {
+		const size_t image = b * m_inputShape.size();
+		for(size_t oy = 0; oy != m_outputShape.height; ++oy) {
+			for(size_t ox = 0; ox != m_outputShape.width; ++ox) {
+				std::fill_n(z, channels, (flt_t)0);
+				for(size_t ky = 0; ky != m_kernelSize; ++ky) {
+					for(size_t kx = 0; kx != m_kernelSize; ++kx) {
+						const flt_t* pixel = inputs + image + ((oy * m_stride + ky) * m_inputShape.width + ox * m_stride + kx) * channels;
+						for(size_t c = 0; c != channels; ++c)
+							z[c] += pixel[c];
+					}
+				}
+				for(size_t c = 0; c != channels; ++c)
+					z[c] *= scale;
+				z += channels;
+			}
+		}
+	}
+}
+
+void AveragePool2D::backward(const flt_t*, const flt_t* errors, flt_t* inputErrors, const size_t batchSize) {
+	if (inputErrors == nullptr)
+		return;
+	const size_t channels = m_inputShape.channels;
+	const flt_t scale = (flt_t)1 / (m_kernelSize * m_kernelSize);
+	std::fill_n(inputErrors, batchSize * m_inputShape.size(), (flt_t)0);
+	for(size_t b = 0; b != batchSize; ++b) {
+		flt_t* image = inputErrors + b * m_inputShape.size();
+		for(size_t oy = 0; oy != m_outputShape.height; ++oy) {
+			for(size_t ox = 0; ox != m_outputShape.width; ++ox) {
+				for(size_t ky = 0; ky != m_kernelSize; ++ky) {
+					for(size_t kx = 0; kx != m_kernelSize; ++kx) {
+						flt_t* pixel = image + ((oy * m_stride + ky) * m_inputShape.width + ox * m_stride + kx) * channels;
+						for(size_t c = 0; c != channels; ++c)
+							pixel[c] += scale * errors[c];
+					}
+				}
+				errors += channels;
+			}
+		}
+	}
+}
+
+} /* namespace nn */
@@ -0,0 +1,113 @@
+#ifndef _NN_POOLING_HPP_
+#define _NN_POOLING_HPP_
+
+#include <vector>
+#include <memory>
+#include <ostream>
+#include "utils.hpp"
+#include "Layer.hpp"
+
+namespace nn {
+
+/**
+ * @brief a layer without parameters that shrinks every channel of an image,
+ *   replacing every square window of pixels with a single value. It is
+ *   usually given the linear activation function, since the activation
+ *   function of the previous layer is already applied.
+ * @see MaxPool2D
+ * @see AveragePool2D
+ */
+class Pooling : public Layer {
+public:
+	size_t inputSize() const override {
+		return m_inputShape.size();
+	}
+	size_t outputSize() const override {
+		return m_outputShape.size();
+	}
+	size_t multiplyAdds() const override {
+		return m_outputShape.size() * m_kernelSize * m_kernelSize;
+	}
+
+	const ImageShape& inputShape() const {
+		return m_inputShape;
+	}
+	const ImageShape& outputShape() const {
+		return m_outputShape;
+	}
+
+protected:
+	/**
+	 * @param inputShape the shape of the image of the previous layer
+	 * @param kernelSize the width and height of the windows
+	 * @param stride the distance between windows
+	 */
+	Pooling(const ImageShape& inputShape, const size_t kernelSize, const size_t stride);
+
+	void writeShape(std::ostream& out) const override;
+
+	ImageShape m_inputShape, m_outputShape;
+	size_t m_kernelSize, m_stride;
+};
+
+/**
+ * @brief keeps the largest value of every window, and propagates the errors
+ *   only to it
+ */
+class MaxPool2D : public Pooling {
+public:
+	/**
+	 * @param inputShape the shape of the image of the previous layer
+	 * @param kernelSize the width and height of the windows
+	 * @param stride the distance between windows, by default windows do not overlap
+	 */
+	MaxPool2D(const ImageShape& inputShape, const size_t kernelSize, const size_t stride = 0);
+
+	std::unique_ptr<Layer> clone() const override;
+	const char* name() const override {
+		return "maxpool2d";
+	}
+	void forward(const flt_t* inputs, flt_t* z, const size_t batchSize) override;
+	void infer(const flt_t* inputs, flt_t* z, const size_t batchSize) const override;
+	void backward(const flt_t* inputs, const flt_t* errors, flt_t* inputErrors, const size_t batchSize) override;
+
+	size_t activationBytes() const override {
+		return m_maxIndices.capacity() * sizeof(size_t);
+	}
+
+private:
+	/**
+	 * @brief finds the largest input of every output of a sample
+	 * @param maxIndices where to write outputSize() indices in the inputs
+	 */
+	void findMaxima(const flt_t* inputs, size_t* maxIndices) const;
+
+	std::vector<size_t> m_maxIndices; // in the inputs of the batch, for every output
+};
+
+/**
+ * @brief keeps the average of every window, and spreads the errors evenly over it
+ */
+class AveragePool2D : public Pooling {
+public:
+	/**
+	 * @param inputShape the shape of the image of the previous layer
+	 * @param kernelSize the width and height of the windows
+	 * @param stride the distance between windows, by default windows do not overlap
+	 */
+	AveragePool2D(const ImageShape& inputShape, const size_t kernelSize, const size_t stride = 0);
+
+	std::unique_ptr<Layer> clone() const override;
+	const char* name() const override {
+		return "averagepool2d";
+	}
+	void forward(const flt_t* inputs, flt_t* z, const size_t batchSize) override {
+		infer(inputs, z, batchSize);
+	}
+	void infer(const flt_t* inputs, flt_t* z, const size_t batchSize) const override;
+	void backward(const flt_t* inputs, const flt_t* errors, flt_t* inputErrors, const size_t batchSize) override;
+};
+
+} // namespace nn
+
+#endif // _NN_POOLING_HPP_
@@ -0,0 +1,21 @@
+#include "Profiler.hpp"
+
+
+namespace nn {
+
+bool Profiler::setCounting(const bool counting) {
+	if (!counting || !NN_PROFILING) {
+		m_counters.reset();
+		return false;
+	}
+
+	if (!m_counters)
+		m_counters = std::make_unique<PerfCounters>();
+	if (!m_counters->isAnyAvailable()) {
+		m_counters.reset();
+		return false;
+	}
+	return true;
+}
+
+} /* namespace nn */
@@ -0,0 +1,115 @@
+#ifndef _NN_PROFILER_HPP_
+#define _NN_PROFILER_HPP_
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include "utils.hpp"
+#include "PerfCounters.hpp"
+
+// Set to 0 to compile all profiling scopes away
+#ifndef NN_PROFILING
+#define NN_PROFILING 1
+#endif
+
+namespace nn {
+
+/**
+ * @brief accumulates the wall-clock time spent in the phases of training and
+ *   evaluation, and optionally the hardware performance counters of the thread
+ *   running them. It is disabled by default: when disabled at runtime a scope
+ *   costs a single branch, and when NN_PROFILING is 0 scopes are empty.
+ */
+class Profiler {
+public:
+	enum Phase : size_t {
+		shuffle, forward, backward, accumulate, update, evaluate, cost,
+		phaseCount,
+	};
+	static constexpr const char* phaseNames[phaseCount] = {
+		"shuffle", "forward", "backward", "accumulate", "update", "evaluate", "cost",
+	};
+
+	/**
+	 * @brief measures the time between its construction and destruction and
+	 *   adds it to a phase of the profiler
+	 */
+	class Scope {
+#if NN_PROFILING
+		Profiler& m_profiler;
+		const Phase m_phase;
+		std::chrono::steady_clock::time_point m_start;
+		PerfCounters::Values m_startCounts;
+
+	public:
+		Scope(Profiler& profiler, const Phase phase) : m_profiler{profiler}, m_phase{phase}, m_start{} {
+			if (m_profiler.m_enabled) {
+				if (m_profiler.m_counters)
+					m_startCounts = m_profiler.m_counters->read();
+				m_start = std::chrono::steady_clock::now();
+			}
+		}
+		~Scope() {
+			if (m_profiler.m_enabled) {
+				m_profiler.m_seconds[m_phase] += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+				if (m_profiler.m_counters) {
+					PerfCounters::Values counts = m_profiler.m_counters->read();
+					for(size_t c = 0; c != PerfCounters::counterCount; ++c)
+						m_profiler.m_counts[m_phase][c] += counts[c] - m_startCounts[c];
+				}
+			}
+		}
+#else
+	public:
+		Scope(Profiler&, const Phase) {}
+#endif
+	};
+
+	Profiler() : m_enabled{false}, m_seconds{}, m_counters{}, m_counts{} {}
+
+	void setEnabled(const bool enabled) {
+		m_enabled = NN_PROFILING && enabled;
+	}
+	bool isEnabled() const {
+		return m_enabled;
+	}
+
+	/**
+	 * @brief starts or stops also sampling hardware performance counters in
+	 *   every scope. They are bound to the calling thread, which has to be the
+	 *   one running the profiled code.
+	 * @return `false` if no counter is available on this system
+	 */
+	bool setCounting(const bool counting);
+	bool isCounting() const {
+		return m_counters != nullptr;
+	}
+
+	/**
+	 * @brief sets the time and the counters of all phases back to 0
+	 */
+	void reset() {
+		m_seconds.fill(0.0);
+		m_counts.fill(PerfCounters::Values{});
+	}
+
+	double seconds(const Phase phase) const {
+		return m_seconds[phase];
+	}
+	const PerfCounters::Values& counts(const Phase phase) const {
+		return m_counts[phase];
+	}
+	bool isCounterAvailable(const PerfCounters::Counter counter) const {
+		return m_counters && m_counters->isAvailable(counter);
+	}
+
+private:
+	bool m_enabled;
+	std::array<double, phaseCount> m_seconds;
+	std::unique_ptr<PerfCounters> m_counters; // nullptr if not counting
+	std::array<PerfCounters::Values, phaseCount> m_counts;
+};
+
+} // namespace nn
+
+#endif // _NN_PROFILER_HPP_
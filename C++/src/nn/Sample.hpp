@@ -2,13 +2,27 @@
 #define _NN_SAMPLE_HPP_
 
 #include <vector>
+#include <cstdint>
+#include <stdexcept>
 #include "utils.hpp"
 
 namespace nn {
 
 class Sample {
+public:
+	static constexpr size_t noClass = (size_t)-1;
+
+private:
 	std::vector<flt_t> inputs;
 	std::vector<flt_t> expectedOutputs;
+	size_t expectedClass;
+	std::vector<uint32_t> nonzeroInputs;
+	bool nonzeroInputsComputed = false;
+
+	// sparse samples store only their nonzero inputs, in nonzeroInputs and nonzeroValues
+	bool sparse = false;
+	size_t sparseInputCount = 0;
+	std::vector<flt_t> nonzeroValues;
 
 public:
 	/**
@@ -18,7 +32,7 @@ public:
 	 * @param data the data to use both as inputs and expected outputs
 	 */
 	Sample(const std::vector<flt_t>& data)
-			: inputs{data}, expectedOutputs{} {}
+			: inputs{data}, expectedOutputs{}, expectedClass{noClass} {}
 	/**
 	 * @brief Construct a Sample to be used for autoclassifiers:
 	 * inputs will also be used as expected outputs
@@ -26,7 +40,7 @@ public:
 	 * @param data the data to use both as inputs and expected outputs
 	 */
 	Sample(const std::vector<flt_t>&& data)
-			: inputs{data}, expectedOutputs{} {}
+			: inputs{data}, expectedOutputs{}, expectedClass{noClass} {}
 
 	/**
 	 * @brief Construct a Sample with inputs and expected outputs
@@ -35,7 +49,7 @@ public:
 	 * @param expectedOutputs the expected outputs corresponding to the inputs
 	 */
 	Sample(const std::vector<flt_t>& inputs, const std::vector<flt_t>& expectedOutputs)
-			: inputs{inputs}, expectedOutputs{expectedOutputs} {}
+			: inputs{inputs}, expectedOutputs{expectedOutputs}, expectedClass{noClass} {}
 
 	/**
 	 * @brief Construct a Sample with inputs and the classifer output
@@ -45,21 +59,160 @@ public:
 	 * @param classCount the number of all possible classes, which determines the expected outputs length
 	 */
 	Sample(const std::vector<flt_t>& inputs, const size_t expectedClass, const size_t classCount)
-			: inputs{inputs}, expectedOutputs(classCount, (flt_t) 0.0) {
+			: inputs{inputs}, expectedOutputs(classCount, (flt_t) 0.0), expectedClass{expectedClass} {
 		expectedOutputs[expectedClass] = (flt_t) 1.0;
 	}
 
+	/**
+	 * @brief Construct a Sample for a classifier that stores only the expected
+	 * class, without expanding it into one expected output per class.
+	 * Use it with a softmax output layer and CategoricalCrossEntropyCost.
+	 *
+	 * @param inputs the inputs
+	 * @param expectedClass the expected class corresponding to the inputs
+	 */
+	Sample(const std::vector<flt_t>& inputs, const size_t expectedClass)
+			: inputs{inputs}, expectedOutputs{}, expectedClass{expectedClass} {}
+
+	/**
+	 * @brief Construct a sparse Sample for a classifier, which stores only the
+	 * nonzero inputs, for high dimensional inputs with few nonzero ones
+	 *
+	 * @param inputCount the number of all inputs, zero or not
+	 * @param nonzeroInputs the indices of the nonzero inputs, in increasing order
+	 * @param nonzeroValues the values of the nonzero inputs
+	 * @param expectedClass the expected class corresponding to the inputs
+	 */
+	Sample(const size_t inputCount, std::vector<uint32_t> nonzeroInputs,
+			std::vector<flt_t> nonzeroValues, const size_t expectedClass)
+			: inputs{}, expectedOutputs{}, expectedClass{expectedClass},
+			nonzeroInputs{std::move(nonzeroInputs)}, nonzeroInputsComputed{true},
+			sparse{true}, sparseInputCount{inputCount}, nonzeroValues{std::move(nonzeroValues)} {}
+
+	/**
+	 * @brief Construct a sparse Sample with expected outputs
+	 *
+	 * @see Sample(const size_t, std::vector<uint32_t>, std::vector<flt_t>, const size_t)
+	 * @param expectedOutputs the expected outputs corresponding to the inputs
+	 */
+	Sample(const size_t inputCount, std::vector<uint32_t> nonzeroInputs,
+			std::vector<flt_t> nonzeroValues, const std::vector<flt_t>& expectedOutputs)
+			: inputs{}, expectedOutputs{expectedOutputs}, expectedClass{noClass},
+			nonzeroInputs{std::move(nonzeroInputs)}, nonzeroInputsComputed{true},
+			sparse{true}, sparseInputCount{inputCount}, nonzeroValues{std::move(nonzeroValues)} {}
+
+	/**
+	 * @brief not available for sparse samples
+	 * @see isSparse
+	 */
 	const std::vector<flt_t>& getInputs() const {
+		if (sparse)
+			throw std::runtime_error{"The sample is sparse, its inputs are not stored"};
 		return inputs;
 	}
 
+	/**
+	 * @return `true` if only the nonzero inputs are stored
+	 * @see getNonzeroInputs
+	 * @see getNonzeroValues
+	 */
+	bool isSparse() const {
+		return sparse;
+	}
+
+	/**
+	 * @return the number of all inputs, zero or not
+	 */
+	size_t getInputCount() const {
+		return sparse ? sparseInputCount : inputs.size();
+	}
+
+	/**
+	 * @return the values of the nonzero inputs of a sparse sample, in the
+	 *   order of getNonzeroInputs
+	 */
+	const std::vector<flt_t>& getNonzeroValues() const {
+		return nonzeroValues;
+	}
+
+	/**
+	 * @brief stores the indices of the nonzero inputs, so that the first layer
+	 *   of a Network does not have to look for them at every pass over a
+	 *   sparse sample (e.g. an image that is mostly background)
+	 */
+	void computeNonzeroInputs() {
+		if (sparse)
+			return;
+		nonzeroInputs.clear();
+		for(size_t i = 0; i != inputs.size(); ++i) {
+			if (inputs[i] != 0)
+				nonzeroInputs.push_back(i);
+		}
+		nonzeroInputsComputed = true;
+	}
+
+	/**
+	 * @return `true` if the sample is sparse or computeNonzeroInputs was
+	 *   called, even if all inputs are 0
+	 */
+	bool hasNonzeroInputs() const {
+		return nonzeroInputsComputed;
+	}
+
+	const std::vector<uint32_t>& getNonzeroInputs() const {
+		return nonzeroInputs;
+	}
+
+	/**
+	 * @brief not available if the sample has only the expected class
+	 * @see hasOnlyExpectedClass
+	 * @see getExpectedOutput
+	 */
 	const std::vector<flt_t>& getExpectedOutputs() const {
+		if (hasOnlyExpectedClass())
+			throw std::runtime_error{"The sample has only the expected class, not the expected outputs"};
 		return expectedOutputs.size() == 0 ? inputs : expectedOutputs;
 	}
 
+	/**
+	 * @brief the expected output of a single output node, available for all samples
+	 */
+	flt_t getExpectedOutput(const size_t index) const {
+		if (hasOnlyExpectedClass())
+			return index == expectedClass;
+		return expectedOutputs.size() == 0 ? inputs[index] : expectedOutputs[index];
+	}
+
+	/**
+	 * @return the expected class, or noClass if the sample was not constructed with one
+	 */
+	size_t getExpectedClass() const {
+		return expectedClass;
+	}
+
+	/**
+	 * @return `true` if the sample stores only the expected class, not the expected outputs
+	 */
+	bool hasOnlyExpectedClass() const {
+		return expectedOutputs.size() == 0 && expectedClass != noClass;
+	}
+
+	/**
+	 * @return `true` if the inputs are also used as expected outputs
+	 */
+	bool isAutoclassifier() const {
+		return expectedOutputs.size() == 0 && expectedClass == noClass;
+	}
+
 	void swap(nn::Sample& other) {
 		std::swap(inputs, other.inputs);
 		std::swap(expectedOutputs, other.expectedOutputs);
+		std::swap(expectedClass, other.expectedClass);
+		std::swap(nonzeroInputs, other.nonzeroInputs);
+		std::swap(nonzeroInputsComputed, other.nonzeroInputsComputed);
+		std::swap(sparse, other.sparse);
+		std::swap(sparseInputCount, other.sparseInputCount);
+		std::swap(nonzeroValues, other.nonzeroValues);
 	}
 };
 
@@ -0,0 +1,42 @@
+#ifndef _NN_SAMPLESOURCE_HPP_
+#define _NN_SAMPLESOURCE_HPP_
+
+#include <vector>
+#include "utils.hpp"
+#include "Sample.hpp"
+
+namespace nn {
+
+/**
+ * @brief a producer of samples that does not need to keep the whole dataset
+ *   in memory as a `std::vector<Sample>`. The samples are handed out in mini
+ *   batches, one pass (epoch) at a time.
+ */
+class SampleSource {
+public:
+	virtual ~SampleSource() = default;
+
+	/**
+	 * @brief starts a new pass over the samples, reshuffling them if the source
+	 *   supports it. Any batch of the previous pass not yet retrieved is dropped.
+	 * @param batchSize how many samples every call to nextBatch should return
+	 *   (the last batch of a pass may contain fewer)
+	 */
+	virtual void rewind(const size_t batchSize) = 0;
+
+	/**
+	 * @brief retrieves the next batch of the current pass
+	 * @param batch where to put the samples; its previous content is replaced
+	 * @return `false` if the current pass is over and `batch` was left empty
+	 */
+	virtual bool nextBatch(std::vector<Sample>& batch) = 0;
+
+	/**
+	 * @return the number of samples in a full pass
+	 */
+	virtual size_t size() const = 0;
+};
+
+} // namespace nn
+
+#endif // _NN_SAMPLESOURCE_HPP_
@@ -0,0 +1,208 @@
+#include "SparseDataset.hpp"
+
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include <numeric>
+#include <map>
+
+namespace nn {
+
+namespace {
+	constexpr char sparseMagic[8] = {'N', 'N', 'S', 'P', 'A', 'R', 'S', '1'};
+
+	template<class T>
+	void writeArray(std::ofstream& file, const std::vector<T>& array) {
+		file.write(reinterpret_cast<const char*>(array.data()), array.size() * sizeof(T));
+	}
+
+	template<class T>
+	std::vector<T> readArray(std::ifstream& file, const uint64_t size) {
+		std::vector<T> array(size);
+		file.read(reinterpret_cast<char*>(array.data()), size * sizeof(T));
+		return array;
+	}
+}
+
+SparseDataset::SparseDataset(const size_t inputCount,
+		std::vector<double> labels,
+		std::vector<uint64_t> rowOffsets,
+		std::vector<uint32_t> indices,
+		std::vector<flt_t> values,
+		std::vector<uint32_t> classes,
+		const bool shuffle,
+		const unsigned int seed) :
+		m_inputCount{inputCount}, m_labels{std::move(labels)}, m_rowOffsets{std::move(rowOffsets)},
+		m_indices{std::move(indices)}, m_values{std::move(values)}, m_classes{std::move(classes)},
+		m_shuffle{shuffle}, m_engine{seed}, m_order(m_classes.size()), m_next{0}, m_batchSize{1} {
+	if (m_rowOffsets.size() != m_classes.size() + 1 || m_rowOffsets.back() != m_indices.size()
+			|| m_indices.size() != m_values.size())
+		throw std::runtime_error{"Inconsistent sizes of the sparse dataset arrays"};
+	for(auto&& expectedClass : m_classes) {
+		if (expectedClass >= m_labels.size())
+			throw std::runtime_error{"Sparse dataset class " + std::to_string(expectedClass) + " has no label"};
+	}
+	for(auto&& index : m_indices) {
+		if (index >= m_inputCount)
+			throw std::runtime_error{"Sparse dataset input index " + std::to_string(index)
+				+ " is not less than the input count " + std::to_string(m_inputCount)};
+	}
+	std::iota(m_order.begin(), m_order.end(), 0);
+}
+
+void SparseDataset::rewind(const size_t batchSize) {
+	if (m_shuffle)
+		std::shuffle(m_order.begin(), m_order.end(), m_engine);
+	m_next = 0;
+	m_batchSize = std::max<size_t>(1, batchSize);
+}
+
+bool SparseDataset::nextBatch(std::vector<Sample>& batch) {
+	batch.clear();
+	for(; m_next != m_order.size() && batch.size() != m_batchSize; ++m_next) {
+		batch.push_back(sample(m_order[m_next]));
+	}
+	return !batch.empty();
+}
+
+size_t SparseDataset::size() const {
+	return m_classes.size();
+}
+
+Sample SparseDataset::sample(const size_t row) const {
+	const auto begin = m_rowOffsets[row], end = m_rowOffsets[row + 1];
+	return Sample{m_inputCount,
+		std::vector<uint32_t>(m_indices.begin() + begin, m_indices.begin() + end),
+		std::vector<flt_t>(m_values.begin() + begin, m_values.begin() + end),
+		m_classes[row]};
+}
+
+void SparseDataset::writeBinary(const std::string& filename) const {
+	std::ofstream file{filename, std::ios::binary};
+	file.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+
+	const uint64_t header[4] = {m_classes.size(), m_inputCount, m_values.size(), m_labels.size()};
+	file.write(sparseMagic, sizeof(sparseMagic));
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	writeArray(file, m_labels);
+	writeArray(file, m_rowOffsets);
+	writeArray(file, m_indices);
+	writeArray(file, m_values);
+	writeArray(file, m_classes);
+}
+
+
+SparseDataset readLibsvm(const std::string& filename,
+		const size_t inputCount,
+		const bool shuffle,
+		const unsigned int seed) {
+	std::ifstream file{filename};
+	if (!file)
+		throw std::runtime_error{"Could not open " + filename};
+
+	std::vector<double> rowLabels;
+	std::vector<uint64_t> rowOffsets{0};
+	std::vector<uint32_t> indices;
+	std::vector<flt_t> values;
+	size_t maxIndex = 0;
+
+	std::string line;
+	std::vector<std::pair<uint32_t, flt_t>> row;
+	for(size_t lineNumber = 1; std::getline(file, line); ++lineNumber) {
+		if (size_t comment = line.find('#'); comment != std::string::npos)
+			line.resize(comment);
+
+		// strtod and strtoul are much faster than streams on big files
+		const char* position = line.c_str();
+		char* end;
+		const double label = std::strtod(position, &end);
+		if (end == position) {
+			if (line.find_first_not_of(" \t\r") == std::string::npos)
+				continue; // empty line
+			throw std::runtime_error{filename + ":" + std::to_string(lineNumber) + ": missing label"};
+		}
+		position = end;
+
+		row.clear();
+		while(true) {
+			while(*position == ' ' || *position == '\t' || *position == '\r')
+				++position;
+			if (*position == '\0')
+				break;
+
+			const unsigned long index = std::strtoul(position, &end, 10);
+			if (end == position || *end != ':' || index == 0)
+				throw std::runtime_error{filename + ":" + std::to_string(lineNumber) + ": invalid index:value pair"};
+			position = end + 1;
+			const flt_t value = std::strtod(position, &end);
+			if (end == position)
+				throw std::runtime_error{filename + ":" + std::to_string(lineNumber) + ": invalid value"};
+			position = end;
+
+			if (value != 0)
+				row.push_back({index - 1, value});
+			maxIndex = std::max<size_t>(maxIndex, index);
+		}
+
+		// indices are usually sorted already
+		if (!std::is_sorted(row.begin(), row.end()))
+			std::sort(row.begin(), row.end());
+		for(auto&& [index, value] : row) {
+			indices.push_back(index);
+			values.push_back(value);
+		}
+		rowOffsets.push_back(indices.size());
+		rowLabels.push_back(label);
+	}
+
+	if (inputCount != 0 && maxIndex > inputCount)
+		throw std::runtime_error{filename + " has index " + std::to_string(maxIndex)
+			+ " but only " + std::to_string(inputCount) + " inputs were expected"};
+
+	// labels are numbered in increasing order to become classes
+	std::map<double, uint32_t> classOfLabel;
+	for(auto&& label : rowLabels)
+		classOfLabel.emplace(label, 0);
+	std::vector<double> labels;
+	for(auto&& [label, expectedClass] : classOfLabel) {
+		expectedClass = labels.size();
+		labels.push_back(label);
+	}
+	std::vector<uint32_t> classes;
+	classes.reserve(rowLabels.size());
+	for(auto&& label : rowLabels)
+		classes.push_back(classOfLabel[label]);
+
+	return SparseDataset{inputCount == 0 ? maxIndex : inputCount, std::move(labels), std::move(rowOffsets),
+		std::move(indices), std::move(values), std::move(classes), shuffle, seed};
+}
+
+SparseDataset readSparseBinary(const std::string& filename,
+		const bool shuffle,
+		const unsigned int seed) {
+	std::ifstream file{filename, std::ios::binary};
+	if (!file)
+		throw std::runtime_error{"Could not open " + filename};
+	file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+	char magic[sizeof(sparseMagic)];
+	uint64_t header[4];
+	file.read(magic, sizeof(magic));
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	if (std::memcmp(magic, sparseMagic, sizeof(magic)) != 0)
+		throw std::runtime_error{"Invalid sparse dataset header in " + filename};
+	const auto [sampleCount, inputCount, nonzeroCount, classCount] = header;
+
+	std::vector<double> labels = readArray<double>(file, classCount);
+	std::vector<uint64_t> rowOffsets = readArray<uint64_t>(file, sampleCount + 1);
+	std::vector<uint32_t> indices = readArray<uint32_t>(file, nonzeroCount);
+	std::vector<flt_t> values = readArray<flt_t>(file, nonzeroCount);
+	std::vector<uint32_t> classes = readArray<uint32_t>(file, sampleCount);
+
+	return SparseDataset{inputCount, std::move(labels), std::move(rowOffsets),
+		std::move(indices), std::move(values), std::move(classes), shuffle, seed};
+}
+
+} /* namespace nn */
@@ -0,0 +1,115 @@
+#ifndef _NN_SPARSEDATASET_HPP_
+#define _NN_SPARSEDATASET_HPP_
+
+#include <vector>
+#include <string>
+#include <random>
+#include <cstdint>
+#include "utils.hpp"
+#include "Sample.hpp"
+#include "SampleSource.hpp"
+
+namespace nn {
+
+/**
+ * @brief a classification dataset with high dimensional sparse inputs, stored
+ *   in compressed sparse row (CSR) format: the nonzero inputs of all samples
+ *   are in two contiguous arrays, and every sample is a range of them. It
+ *   produces sparse samples, which Network trains on without ever expanding
+ *   their inputs.
+ * @see readLibsvm
+ * @see readSparseBinary
+ */
+class SparseDataset : public SampleSource {
+public:
+	/**
+	 * @param inputCount the number of all inputs of every sample, zero or not
+	 * @param labels the original label of every class, e.g. as in the libsvm file
+	 * @param rowOffsets where the nonzero inputs of every sample start, plus the
+	 *   total number of nonzero inputs at the end
+	 * @param indices the index of every nonzero input, increasing in every sample
+	 * @param values the value of every nonzero input
+	 * @param classes the expected class of every sample
+	 * @param shuffle whether to shuffle the samples at every pass
+	 * @param seed seed for the shuffling
+	 */
+	SparseDataset(const size_t inputCount,
+		std::vector<double> labels,
+		std::vector<uint64_t> rowOffsets,
+		std::vector<uint32_t> indices,
+		std::vector<flt_t> values,
+		std::vector<uint32_t> classes,
+		const bool shuffle = true,
+		const unsigned int seed = std::random_device{}());
+
+	void rewind(const size_t batchSize) override;
+	bool nextBatch(std::vector<Sample>& batch) override;
+	size_t size() const override;
+
+	/**
+	 * @brief builds the sparse sample of a row
+	 * @param row the index of the sample in the dataset, not in the shuffled order
+	 */
+	Sample sample(const size_t row) const;
+
+	size_t inputCount() const {
+		return m_inputCount;
+	}
+	size_t classCount() const {
+		return m_labels.size();
+	}
+	size_t nonzeroCount() const {
+		return m_values.size();
+	}
+	const std::vector<double>& labels() const {
+		return m_labels;
+	}
+
+	/**
+	 * @brief writes the dataset to a binary file, which loads much faster than
+	 *   a text one
+	 * @see readSparseBinary
+	 */
+	void writeBinary(const std::string& filename) const;
+
+private:
+	size_t m_inputCount;
+	std::vector<double> m_labels;
+	std::vector<uint64_t> m_rowOffsets;
+	std::vector<uint32_t> m_indices;
+	std::vector<flt_t> m_values;
+	std::vector<uint32_t> m_classes;
+
+	bool m_shuffle;
+	std::mt19937 m_engine;
+	std::vector<size_t> m_order;
+	size_t m_next, m_batchSize;
+};
+
+/**
+ * @brief reads a dataset in the libsvm text format, with one sample per line:
+ *   `label index:value index:value ...`, where indices start from 1. Labels are
+ *   sorted and numbered to become classes, and text after `#` is ignored.
+ * @param filename the file to read
+ * @param inputCount the number of inputs, or 0 to use the largest index found
+ * @param shuffle @see SparseDataset
+ * @param seed @see SparseDataset
+ */
+SparseDataset readLibsvm(const std::string& filename,
+	const size_t inputCount = 0,
+	const bool shuffle = true,
+	const unsigned int seed = std::random_device{}());
+
+/**
+ * @brief reads a dataset written by SparseDataset::writeBinary
+ * @param filename the file to read
+ * @param shuffle @see SparseDataset
+ * @param seed @see SparseDataset
+ */
+SparseDataset readSparseBinary(const std::string& filename,
+	const bool shuffle = true,
+	const unsigned int seed = std::random_device{}());
+
+} // namespace nn
+
+#endif // _NN_SPARSEDATASET_HPP_
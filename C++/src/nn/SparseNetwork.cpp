@@ -0,0 +1,150 @@
+#include "SparseNetwork.hpp"
+
+#include <string>
+#include <stdexcept>
+
+namespace nn {
+
+SparseNetwork::SparseNetwork() :
+		m_inputCount{0}, m_layers{}, m_inputs{}, m_outputs{} {}
+
+SparseNetwork::SparseNetwork(const Network& network) :
+		m_inputCount{network.m_nodes.empty() ? 0 : network.m_nodes[0].size()},
+		m_layers{}, m_inputs{}, m_outputs{} {
+	for(size_t x = 1; x != network.m_nodes.size(); ++x) {
+		const DenseLayer* dense = network.denseLayer(x);
+		if (!dense)
+			throw std::runtime_error{std::string{"Cannot convert the "} + network.m_layers[x]->name() + " layer "
+				+ std::to_string(x) + " to a sparse layer"};
+		m_layers.push_back({});
+		Layer& layer = m_layers.back();
+		layer.activationFunction = network.m_activationFunctions[x];
+		layer.rowOffsets.push_back(0);
+		for(size_t y = 0; y != dense->outputSize(); ++y) {
+			layer.biases.push_back(dense->biases()[y]);
+			const flt_t* weights = dense->row(y);
+			for(size_t yFrom = 0; yFrom != dense->inputSize(); ++yFrom) {
+				if (weights[yFrom] != 0) {
+					layer.indices.push_back(yFrom);
+					layer.weights.push_back(weights[yFrom]);
+				}
+			}
+			layer.rowOffsets.push_back(layer.weights.size());
+		}
+	}
+}
+
+std::vector<flt_t> SparseNetwork::calculate(const std::vector<flt_t>& inputs) {
+	if (inputs.size() != m_inputCount)
+		throw std::runtime_error{"Expected " + std::to_string(m_inputCount)
+			+ " inputs but got " + std::to_string(inputs.size())};
+
+	m_inputs = inputs;
+	for(auto&& layer : m_layers) {
+		m_outputs.resize(layer.biases.size());
+		const flt_t* in = m_inputs.data();
+		const uint32_t* indices = layer.indices.data();
+		const flt_t* weights = layer.weights.data();
+
+		for(size_t y = 0; y != layer.biases.size(); ++y) {
+			const uint32_t end = layer.rowOffsets[y+1];
+			uint32_t i = layer.rowOffsets[y];
+
+			// independent sums overlap the latencies of the gathered loads and of the additions
+			flt_t sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+			for(; i + 4 <= end; i += 4) {
+				sum0 += weights[i]   * in[indices[i]];
+				sum1 += weights[i+1] * in[indices[i+1]];
+				sum2 += weights[i+2] * in[indices[i+2]];
+				sum3 += weights[i+3] * in[indices[i+3]];
+			}
+			for(; i != end; ++i) {
+				sum0 += weights[i] * in[indices[i]];
+			}
+			m_outputs[y] = layer.biases[y] + ((sum0 + sum1) + (sum2 + sum3));
+		}
+
+		layer.activationFunction->apply(m_outputs.data(), m_outputs.data(), m_outputs.size());
+		std::swap(m_inputs, m_outputs);
+	}
+	return m_inputs;
+}
+
+size_t SparseNetwork::nonzeroCount() const {
+	size_t count = 0;
+	for(auto&& layer : m_layers)
+		count += layer.weights.size();
+	return count;
+}
+
+size_t SparseNetwork::weightCount() const {
+	size_t count = 0, inputs = m_inputCount;
+	for(auto&& layer : m_layers) {
+		count += inputs * layer.biases.size();
+		inputs = layer.biases.size();
+	}
+	return count;
+}
+
+std::istream& operator>>(std::istream& in, SparseNetwork& network) {
+	std::string format;
+	in >> format;
+	if (format != "nn-csr-v1")
+		throw std::runtime_error{"Unknown sparse network format " + format};
+
+	size_t layerCount;
+	in >> layerCount >> network.m_inputCount;
+	network.m_layers.assign(layerCount, {});
+
+	size_t inputs = network.m_inputCount;
+	for(auto&& layer : network.m_layers) {
+		size_t ySize;
+		std::string name;
+		in >> ySize >> name;
+		layer.activationFunction = activationFunctionByName(name);
+		if (layer.activationFunction == nullptr)
+			throw std::runtime_error{"Unknown activation function " + name};
+
+		layer.rowOffsets.push_back(0);
+		for(size_t y = 0; y != ySize; ++y) {
+			flt_t bias;
+			size_t weightsSize;
+			in >> bias >> weightsSize;
+			layer.biases.push_back(bias);
+			for(size_t i = 0; i != weightsSize; ++i) {
+				uint32_t index;
+				flt_t weight;
+				in >> index >> weight;
+				if (index >= inputs)
+					throw std::runtime_error{"Invalid weight input " + std::to_string(index)
+						+ " in a layer with " + std::to_string(inputs) + " inputs"};
+				layer.indices.push_back(index);
+				layer.weights.push_back(weight);
+			}
+			layer.rowOffsets.push_back(layer.weights.size());
+		}
+		inputs = ySize;
+	}
+
+	if (!in)
+		throw std::runtime_error{"Truncated sparse network"};
+	return in;
+}
+
+std::ostream& operator<<(std::ostream& out, const SparseNetwork& network) {
+	out << "nn-csr-v1 " << network.m_layers.size() << " " << network.m_inputCount << " ";
+
+	for(auto&& layer : network.m_layers) {
+		out << layer.biases.size() << " " << layer.activationFunction->name() << " ";
+		for(size_t y = 0; y != layer.biases.size(); ++y) {
+			out << layer.biases[y] << " " << layer.rowOffsets[y+1] - layer.rowOffsets[y] << " ";
+			for(uint32_t i = layer.rowOffsets[y]; i != layer.rowOffsets[y+1]; ++i) {
+				out << layer.indices[i] << " " << layer.weights[i] << " ";
+			}
+		}
+	}
+
+	return out;
+}
+
+} /* namespace nn */
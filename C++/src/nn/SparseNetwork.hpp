@@ -0,0 +1,92 @@
+#ifndef _NN_SPARSENETWORK_HPP_
+#define _NN_SPARSENETWORK_HPP_
+
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <cstdint>
+#include "utils.hpp"
+#include "ActivationFunction.hpp"
+#include "Network.hpp"
+
+namespace nn {
+
+/**
+ * @brief inference-only copy of a pruned network, whose weights are stored in
+ *   compressed sparse row (CSR) format: every layer keeps only its nonzero
+ *   weights, with the index of their input, in contiguous arrays. It takes
+ *   less memory and less time than the network it comes from when most of
+ *   the weights are 0, and calculates the same outputs up to rounding.
+ * @see Network::pruneByMagnitude
+ */
+class SparseNetwork {
+public:
+	/**
+	 * @brief an empty network, to be read from a stream
+	 */
+	SparseNetwork();
+
+	/**
+	 * @brief copies the nonzero weights of a network
+	 * @param network the network to copy, usually pruned
+	 */
+	explicit SparseNetwork(const Network& network);
+
+	/**
+	 * @brief calculates the output of the network based on the provided inputs
+	 * @param inputs array of inputs of the same length as the input layer
+	 * @return the values of the output nodes
+	 */
+	std::vector<flt_t> calculate(const std::vector<flt_t>& inputs);
+
+	size_t inputCount() const {
+		return m_inputCount;
+	}
+	size_t outputCount() const {
+		return m_layers.empty() ? m_inputCount : m_layers.back().biases.size();
+	}
+
+	/**
+	 * @return how many weights are stored, over all layers
+	 */
+	size_t nonzeroCount() const;
+
+	/**
+	 * @return how many weights the dense network has, over all layers
+	 */
+	size_t weightCount() const;
+
+	/**
+	 * @brief read the network from an input stream, in the format written by operator<<
+	 * @param in input stream
+	 * @param network the network to save the parameters in
+	 * @return in
+	 */
+	friend std::istream& operator>>(std::istream& in, SparseNetwork& network);
+
+	/**
+	 * @brief write the network to an output stream, starting with "nn-csr-v1"
+	 *   and with the nonzero weights of every node as index-value pairs
+	 * @param out output stream
+	 * @param network the network to write
+	 * @return out
+	 */
+	friend std::ostream& operator<<(std::ostream& out, const SparseNetwork& network);
+
+private:
+	struct Layer {
+		std::vector<flt_t> biases; // one per node
+		std::vector<uint32_t> rowOffsets; // where the weights of every node start, plus the end
+		std::vector<uint32_t> indices; // of the input of every weight
+		std::vector<flt_t> weights;
+		ActivationFunction* activationFunction;
+	};
+
+	size_t m_inputCount;
+	std::vector<Layer> m_layers;
+	std::vector<flt_t> m_inputs, m_outputs; // activations of the current layer and the next one
+};
+
+} // namespace nn
+
+#endif // _NN_SPARSENETWORK_HPP_
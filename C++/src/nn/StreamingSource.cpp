@@ -0,0 +1,195 @@
+#include "StreamingSource.hpp"
+
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace nn {
+
+namespace {
+	constexpr char shardMagic[8] = {'N', 'N', 'S', 'H', 'A', 'R', 'D', '1'};
+	constexpr size_t shardHeaderSize = sizeof(shardMagic) + 3 * sizeof(uint64_t);
+}
+
+void writeShard(const std::string& filename,
+		const std::vector<Sample>::const_iterator& samplesBegin,
+		const std::vector<Sample>::const_iterator& samplesEnd) {
+	std::ofstream file{filename, std::ios::binary};
+	file.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+
+	const uint64_t sampleCount = std::distance(samplesBegin, samplesEnd);
+	const uint64_t inputCount = sampleCount == 0 ? 0 : samplesBegin->getInputs().size();
+	const uint64_t outputCount = (sampleCount == 0 || samplesBegin->isAutoclassifier())
+		? 0 : samplesBegin->getExpectedOutputs().size();
+	file.write(shardMagic, sizeof(shardMagic));
+	file.write(reinterpret_cast<const char*>(&sampleCount), sizeof(sampleCount));
+	file.write(reinterpret_cast<const char*>(&inputCount), sizeof(inputCount));
+	file.write(reinterpret_cast<const char*>(&outputCount), sizeof(outputCount));
+
+	for(auto s = samplesBegin; s != samplesEnd; ++s) {
+		if (s->getInputs().size() != inputCount || (outputCount == 0) != s->isAutoclassifier()
+				|| (outputCount != 0 && s->getExpectedOutputs().size() != outputCount))
+			throw std::runtime_error{"Samples written to shard " + filename + " have different sizes"};
+
+		file.write(reinterpret_cast<const char*>(s->getInputs().data()), inputCount * sizeof(flt_t));
+		if (outputCount != 0)
+			file.write(reinterpret_cast<const char*>(s->getExpectedOutputs().data()), outputCount * sizeof(flt_t));
+	}
+}
+
+
+StreamingSource::StreamingSource(const std::vector<std::string>& filenames,
+		const size_t blockSize,
+		const size_t shuffleBufferSize,
+		const bool shuffle,
+		const unsigned int seed) :
+		m_shards{}, m_inputCount{0}, m_outputCount{0}, m_sampleCount{0},
+		m_blockSize{std::max<size_t>(1, blockSize)}, m_shuffleBufferSize{shuffleBufferSize},
+		m_shuffle{shuffle}, m_engine{seed},
+		m_blocks{}, m_nextBlock{0}, m_batchSize{1}, m_buffer{} {
+	try {
+		openShards(filenames);
+	} catch(...) {
+		for(auto&& shard : m_shards)
+			::close(shard.fd);
+		throw;
+	}
+	m_nextBlock = m_blocks.size();
+}
+
+void StreamingSource::openShards(const std::vector<std::string>& filenames) {
+	for(auto&& filename : filenames) {
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw std::runtime_error{"Could not open shard " + filename};
+		m_shards.push_back({fd, 0});
+
+		char header[shardHeaderSize];
+		if (::pread(fd, header, shardHeaderSize, 0) != (ssize_t)shardHeaderSize
+				|| std::memcmp(header, shardMagic, sizeof(shardMagic)) != 0)
+			throw std::runtime_error{"Invalid shard header in " + filename};
+
+		uint64_t counts[3];
+		std::memcpy(counts, header + sizeof(shardMagic), sizeof(counts));
+		if (m_shards.size() == 1) {
+			m_inputCount = counts[1];
+			m_outputCount = counts[2];
+		} else if (counts[1] != m_inputCount || counts[2] != m_outputCount) {
+			throw std::runtime_error{"Shard " + filename + " has different input or output counts than " + filenames[0]};
+		}
+
+		// mapping the samples past the end of a truncated shard would raise SIGBUS
+		struct stat status;
+		if (::fstat(fd, &status) != 0)
+			throw std::runtime_error{"Could not read the size of shard " + filename};
+		const uint64_t sampleBytes = (counts[1] + counts[2]) * sizeof(flt_t);
+		if (sampleBytes != 0 && ((uint64_t)status.st_size - shardHeaderSize) / sampleBytes < counts[0])
+			throw std::runtime_error{"Shard " + filename + " is truncated: its header announces "
+				+ std::to_string(counts[0]) + " samples of " + std::to_string(sampleBytes) + " bytes, but it has "
+				+ std::to_string(status.st_size) + " bytes"};
+
+		m_shards.back().sampleCount = counts[0];
+		m_sampleCount += counts[0];
+		for(size_t first = 0; first < counts[0]; first += m_blockSize) {
+			m_blocks.push_back({m_shards.size() - 1, first, std::min<size_t>(m_blockSize, counts[0] - first)});
+		}
+	}
+}
+
+StreamingSource::~StreamingSource() {
+	for(auto&& shard : m_shards)
+		::close(shard.fd);
+}
+
+void StreamingSource::rewind(const size_t batchSize) {
+	if (m_shuffle)
+		std::shuffle(m_blocks.begin(), m_blocks.end(), m_engine);
+	m_nextBlock = 0;
+	m_batchSize = std::max<size_t>(1, batchSize);
+	m_buffer.clear();
+}
+
+bool StreamingSource::nextBatch(std::vector<Sample>& batch) {
+	batch.clear();
+	while(batch.size() != m_batchSize) {
+		while(m_buffer.size() < std::max<size_t>(1, m_shuffleBufferSize) && fillBuffer()) {}
+		if (m_buffer.empty())
+			break;
+
+		if (m_shuffle) {
+			size_t i = std::uniform_int_distribution<size_t>{0, m_buffer.size() - 1}(m_engine);
+			m_buffer[i].swap(m_buffer.front());
+		}
+		batch.push_back(std::move(m_buffer.front()));
+		m_buffer.pop_front();
+	}
+	return !batch.empty();
+}
+
+size_t StreamingSource::size() const {
+	return m_sampleCount;
+}
+
+size_t StreamingSource::sampleBytes() const {
+	return (m_inputCount + m_outputCount) * sizeof(flt_t);
+}
+
+size_t StreamingSource::offsetOf(const Block& block) const {
+	return shardHeaderSize + block.first * sampleBytes();
+}
+
+void StreamingSource::prefetch(const Block& block) const {
+	::posix_fadvise(m_shards[block.shard].fd, offsetOf(block), block.count * sampleBytes(), POSIX_FADV_WILLNEED);
+}
+
+StreamingSource::Window StreamingSource::map(const Block& block) const {
+	// mmap offsets must be page aligned
+	static const size_t pageSize = ::sysconf(_SC_PAGESIZE);
+	const size_t offset = offsetOf(block);
+	const size_t alignedOffset = offset - offset % pageSize;
+
+	Window window;
+	window.length = offset - alignedOffset + block.count * sampleBytes();
+	window.address = ::mmap(nullptr, window.length, PROT_READ, MAP_PRIVATE, m_shards[block.shard].fd, alignedOffset);
+	if (window.address == MAP_FAILED)
+		throw std::runtime_error{"Could not map shard block into memory"};
+	::madvise(window.address, window.length, MADV_SEQUENTIAL);
+	window.samples = reinterpret_cast<const flt_t*>(static_cast<const char*>(window.address) + (offset - alignedOffset));
+	return window;
+}
+
+void StreamingSource::unmap(Window& window) const {
+	::munmap(window.address, window.length);
+	window = Window{};
+}
+
+bool StreamingSource::fillBuffer() {
+	if (m_nextBlock == m_blocks.size())
+		return false;
+	const Block& block = m_blocks[m_nextBlock++];
+	if (m_nextBlock != m_blocks.size())
+		prefetch(m_blocks[m_nextBlock]);
+
+	Window window = map(block);
+	const flt_t* data = window.samples;
+	for(size_t i = 0; i != block.count; ++i) {
+		std::vector<flt_t> inputs(data, data + m_inputCount);
+		data += m_inputCount;
+		if (m_outputCount == 0) {
+			m_buffer.emplace_back(std::move(inputs));
+		} else {
+			m_buffer.emplace_back(inputs, std::vector<flt_t>(data, data + m_outputCount));
+			data += m_outputCount;
+		}
+	}
+	unmap(window);
+	return true;
+}
+
+} /* namespace nn */
@@ -0,0 +1,97 @@
+#ifndef _NN_STREAMINGSOURCE_HPP_
+#define _NN_STREAMINGSOURCE_HPP_
+
+#include <vector>
+#include <string>
+#include <random>
+#include <deque>
+#include "utils.hpp"
+#include "Sample.hpp"
+#include "SampleSource.hpp"
+
+namespace nn {
+
+/**
+ * @brief writes samples to a binary shard file readable by StreamingSource.
+ *   The file contains a header (magic, sample count, input count, output
+ *   count) followed by the raw `flt_t` inputs and expected outputs of every
+ *   sample. Autoclassifier samples are stored with an output count of 0.
+ *   All samples must have the same number of inputs and outputs, and samples
+ *   that only have the expected class are not supported.
+ * @param filename the shard file to create
+ * @param [samplesBegin, samplesEnd] the samples to write
+ */
+void writeShard(const std::string& filename,
+	const std::vector<Sample>::const_iterator& samplesBegin,
+	const std::vector<Sample>::const_iterator& samplesEnd);
+
+/**
+ * @brief a SampleSource that streams samples from binary shard files without
+ *   ever loading a whole dataset into memory. Only one block of samples at a
+ *   time is mapped into memory (and the next one is prefetched), so resident
+ *   memory is bounded by the block size and the shuffle buffer.
+ *   Shuffling is two-level: the order of the blocks is shuffled every pass and
+ *   then samples go through a shuffle buffer, from which random ones are drawn.
+ * @see writeShard
+ */
+class StreamingSource : public SampleSource {
+public:
+	/**
+	 * @param filenames the shard files containing the samples; they must all have
+	 *   the same input and output counts
+	 * @param blockSize how many consecutive samples to map into memory at once
+	 * @param shuffleBufferSize how many samples to draw randomly from; set to 0
+	 *   (and shuffle to false) to stream in file order, e.g. for evaluation
+	 * @param shuffle whether to shuffle the order of the blocks every pass
+	 * @param seed seed for the shuffling
+	 */
+	StreamingSource(const std::vector<std::string>& filenames,
+		const size_t blockSize = 4096,
+		const size_t shuffleBufferSize = 16384,
+		const bool shuffle = true,
+		const unsigned int seed = std::random_device{}());
+	~StreamingSource() override;
+
+	StreamingSource(const StreamingSource&) = delete;
+	StreamingSource& operator=(const StreamingSource&) = delete;
+
+	void rewind(const size_t batchSize) override;
+	bool nextBatch(std::vector<Sample>& batch) override;
+	size_t size() const override;
+
+private:
+	struct Shard {
+		int fd;
+		size_t sampleCount;
+	};
+	struct Block {
+		size_t shard, first, count;
+	};
+	struct Window {
+		void* address = nullptr;
+		size_t length = 0;
+		const flt_t* samples = nullptr;
+	};
+
+	std::vector<Shard> m_shards;
+	size_t m_inputCount, m_outputCount, m_sampleCount;
+	size_t m_blockSize, m_shuffleBufferSize;
+	bool m_shuffle;
+	std::mt19937 m_engine;
+
+	std::vector<Block> m_blocks;
+	size_t m_nextBlock, m_batchSize;
+	std::deque<Sample> m_buffer;
+
+	void openShards(const std::vector<std::string>& filenames);
+	size_t sampleBytes() const;
+	size_t offsetOf(const Block& block) const;
+	void prefetch(const Block& block) const;
+	Window map(const Block& block) const;
+	void unmap(Window& window) const;
+	bool fillBuffer();
+};
+
+} // namespace nn
+
+#endif // _NN_STREAMINGSOURCE_HPP_
@@ -0,0 +1,188 @@
+#include "Svd.hpp"
+
+#include <cmath>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace nn {
+
+namespace {
+	using Matrix = std::vector<double>; // row-major
+
+	// how many random vectors more than the rank, and power iterations
+	constexpr size_t oversampling = 10;
+	constexpr size_t powerIterations = 2;
+
+	/**
+	 * @return a * b, with a rows x inner and b inner x columns
+	 */
+	Matrix multiply(const Matrix& a, const Matrix& b, const size_t rows, const size_t inner, const size_t columns) {
+		Matrix c(rows * columns, 0.0);
+		for(size_t i = 0; i != rows; ++i) {
+			for(size_t k = 0; k != inner; ++k) {
+				const double aik = a[i*inner + k];
+				for(size_t j = 0; j != columns; ++j) {
+					c[i*columns + j] += aik * b[k*columns + j];
+				}
+			}
+		}
+		return c;
+	}
+
+	/**
+	 * @return aᵀ * b, with a inner x rows and b inner x columns
+	 */
+	Matrix multiplyTransposed(const Matrix& a, const Matrix& b, const size_t rows, const size_t inner, const size_t columns) {
+		Matrix c(rows * columns, 0.0);
+		for(size_t k = 0; k != inner; ++k) {
+			for(size_t i = 0; i != rows; ++i) {
+				const double aki = a[k*rows + i];
+				for(size_t j = 0; j != columns; ++j) {
+					c[i*columns + j] += aki * b[k*columns + j];
+				}
+			}
+		}
+		return c;
+	}
+
+	/**
+	 * @brief makes the columns of a orthonormal with modified Gram-Schmidt;
+	 *   columns that depend on the previous ones become 0
+	 */
+	void orthonormalize(Matrix& a, const size_t rows, const size_t columns) {
+		for(size_t j = 0; j != columns; ++j) {
+			for(size_t p = 0; p != j; ++p) {
+				double dot = 0;
+				for(size_t i = 0; i != rows; ++i)
+					dot += a[i*columns + p] * a[i*columns + j];
+				for(size_t i = 0; i != rows; ++i)
+					a[i*columns + j] -= dot * a[i*columns + p];
+			}
+
+			double norm = 0;
+			for(size_t i = 0; i != rows; ++i)
+				norm += a[i*columns + j] * a[i*columns + j];
+			norm = std::sqrt(norm);
+			for(size_t i = 0; i != rows; ++i)
+				a[i*columns + j] = norm > 1e-12 ? a[i*columns + j] / norm : 0.0;
+		}
+	}
+
+	/**
+	 * @brief diagonalizes a symmetric matrix with cyclic Jacobi rotations
+	 * @param s n x n, becomes diagonal with the eigenvalues
+	 * @param n the size of the matrix
+	 * @return the eigenvectors as columns
+	 */
+	Matrix symmetricEigenvectors(Matrix& s, const size_t n) {
+		Matrix vectors(n * n, 0.0);
+		for(size_t i = 0; i != n; ++i)
+			vectors[i*n + i] = 1;
+
+		double total = 0;
+		for(auto&& value : s)
+			total += value * value;
+
+		for(int sweep = 0; sweep != 100; ++sweep) {
+			double off = 0;
+			for(size_t p = 0; p != n; ++p)
+				for(size_t q = p + 1; q != n; ++q)
+					off += s[p*n + q] * s[p*n + q];
+			if (off <= 1e-30 * total)
+				break;
+
+			for(size_t p = 0; p != n; ++p) {
+				for(size_t q = p + 1; q != n; ++q) {
+					if (s[p*n + q] == 0)
+						continue;
+
+					// the rotation that zeroes s[p][q]
+					const double theta = (s[q*n + q] - s[p*n + p]) / (2 * s[p*n + q]);
+					const double t = (theta >= 0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta*theta + 1));
+					const double c = 1 / std::sqrt(t*t + 1), sn = t * c;
+
+					for(size_t k = 0; k != n; ++k) {
+						const double skp = s[k*n + p], skq = s[k*n + q];
+						s[k*n + p] = c*skp - sn*skq;
+						s[k*n + q] = sn*skp + c*skq;
+					}
+					for(size_t k = 0; k != n; ++k) {
+						const double spk = s[p*n + k], sqk = s[q*n + k];
+						s[p*n + k] = c*spk - sn*sqk;
+						s[q*n + k] = sn*spk + c*sqk;
+					}
+					for(size_t k = 0; k != n; ++k) {
+						const double vkp = vectors[k*n + p], vkq = vectors[k*n + q];
+						vectors[k*n + p] = c*vkp - sn*vkq;
+						vectors[k*n + q] = sn*vkp + c*vkq;
+					}
+				}
+			}
+		}
+		return vectors;
+	}
+}
+
+TruncatedSvd truncatedSvd(const std::vector<double>& matrix,
+		const size_t rows,
+		const size_t columns,
+		const size_t rank,
+		const unsigned int seed) {
+	if (matrix.size() != rows * columns)
+		throw std::runtime_error{"Expected a matrix of " + std::to_string(rows) + "x" + std::to_string(columns)};
+	if (rank > std::min(rows, columns))
+		throw std::runtime_error{"Rank " + std::to_string(rank) + " is larger than the matrix"};
+	const size_t k = std::min(rank + oversampling, std::min(rows, columns));
+
+	// orthonormal basis y of the range of the matrix
+	std::mt19937 engine{seed};
+	std::normal_distribution<double> distribution{0.0, 1.0};
+	Matrix omega(columns * k);
+	for(auto&& value : omega)
+		value = distribution(engine);
+	Matrix y = multiply(matrix, omega, rows, columns, k);
+	orthonormalize(y, rows, k);
+	for(size_t i = 0; i != powerIterations; ++i) {
+		Matrix z = multiplyTransposed(matrix, y, columns, rows, k);
+		orthonormalize(z, columns, k);
+		y = multiply(matrix, z, rows, columns, k);
+		orthonormalize(y, rows, k);
+	}
+
+	// b = yᵀ * matrix is small: its left singular vectors are the eigenvectors of b * bᵀ
+	const Matrix b = multiplyTransposed(y, matrix, k, rows, columns);
+	Matrix s(k * k, 0.0);
+	for(size_t p = 0; p != k; ++p)
+		for(size_t q = 0; q != k; ++q)
+			for(size_t j = 0; j != columns; ++j)
+				s[p*k + q] += b[p*columns + j] * b[q*columns + j];
+	const Matrix e = symmetricEigenvectors(s, k);
+
+	std::vector<size_t> order(k);
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](size_t l, size_t r){ return s[l*k + l] > s[r*k + r]; });
+
+	TruncatedSvd result{rank, Matrix(rows * rank, 0.0), std::vector<double>(rank), Matrix(columns * rank, 0.0)};
+	for(size_t c = 0; c != rank; ++c) {
+		const size_t o = order[c];
+		result.singularValues[c] = std::sqrt(std::max(0.0, s[o*k + o]));
+
+		for(size_t i = 0; i != rows; ++i)
+			for(size_t p = 0; p != k; ++p)
+				result.u[i*rank + c] += y[i*k + p] * e[p*k + o];
+
+		if (result.singularValues[c] > 1e-12) {
+			for(size_t j = 0; j != columns; ++j) {
+				for(size_t p = 0; p != k; ++p)
+					result.v[j*rank + c] += e[p*k + o] * b[p*columns + j];
+				result.v[j*rank + c] /= result.singularValues[c];
+			}
+		}
+	}
+	return result;
+}
+
+} /* namespace nn */
@@ -0,0 +1,40 @@
+#ifndef _NN_SVD_HPP_
+#define _NN_SVD_HPP_
+
+#include <vector>
+#include <cstddef>
+
+namespace nn {
+
+/**
+ * @brief the largest singular values of a matrix with their singular vectors,
+ *   so that matrix ≈ u * diag(singularValues) * vᵀ
+ */
+struct TruncatedSvd {
+	size_t rank;
+	std::vector<double> u; // rows x rank, row-major
+	std::vector<double> singularValues; // in decreasing order
+	std::vector<double> v; // columns x rank, row-major
+};
+
+/**
+ * @brief randomized truncated singular value decomposition (Halko, Martinsson,
+ *   Tropp): finds the range of the matrix from its product with a few more
+ *   random vectors than the rank, refined by power iterations, and decomposes
+ *   the small projection on it exactly with Jacobi rotations. It takes
+ *   O(rows * columns * rank) time, instead of the cubic time of a full SVD.
+ * @param matrix rows x columns, row-major
+ * @param rows the number of rows of the matrix
+ * @param columns the number of columns of the matrix
+ * @param rank how many singular values to compute, at most min(rows, columns)
+ * @param seed seed of the random vectors
+ */
+TruncatedSvd truncatedSvd(const std::vector<double>& matrix,
+	const size_t rows,
+	const size_t columns,
+	const size_t rank,
+	const unsigned int seed = 0);
+
+} // namespace nn
+
+#endif // _NN_SVD_HPP_
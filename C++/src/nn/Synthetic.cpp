@@ -0,0 +1,145 @@
+#include "Synthetic.hpp"
+
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+namespace nn {
+
+std::vector<Sample> gaussianBlobs(const size_t count,
+		const size_t inputCount,
+		const size_t classCount,
+		const unsigned int seed,
+		const flt_t spread) {
+	std::mt19937 engine{seed};
+	std::normal_distribution<flt_t> normal{0.0, 1.0};
+
+	std::vector<std::vector<flt_t>> centers(classCount, std::vector<flt_t>(inputCount));
+	for(auto&& center : centers)
+		for(auto&& coordinate : center)
+			coordinate = normal(engine);
+
+	std::vector<Sample> samples;
+	samples.reserve(count);
+	std::uniform_int_distribution<size_t> label{0, classCount - 1};
+	std::vector<flt_t> inputs(inputCount);
+	for(size_t i = 0; i != count; ++i) {
+		const size_t expectedClass = label(engine);
+		for(size_t j = 0; j != inputCount; ++j)
+			inputs[j] = centers[expectedClass][j] + spread * normal(engine);
+		samples.emplace_back(inputs, expectedClass, classCount);
+	}
+	return samples;
+}
+
+std::vector<Sample> syntheticDigits(const size_t count,
+		const unsigned int seed,
+		const size_t imageSize) {
+	/*
+		 aaa
+		f   b
+		f   b
+		 ggg
+		e   c
+		e   c
+		 ddd
+	*/
+	struct Segment { flt_t x0, y0, x1, y1; };
+	constexpr Segment segments[7] = {
+		{0, 0,   1, 0  }, // a
+		{1, 0,   1, 0.5}, // b
+		{1, 0.5, 1, 1  }, // c
+		{0, 1,   1, 1  }, // d
+		{0, 0.5, 0, 1  }, // e
+		{0, 0,   0, 0.5}, // f
+		{0, 0.5, 1, 0.5}, // g
+	};
+	constexpr unsigned char digitSegments[10] = { // bit i set if segment i is on
+		0b0111111, 0b0000110, 0b1011011, 0b1001111, 0b1100110,
+		0b1101101, 0b1111101, 0b0000111, 0b1111111, 0b1101111,
+	};
+
+	std::mt19937 engine{seed};
+	std::uniform_int_distribution<size_t> label{0, 9};
+	std::uniform_real_distribution<flt_t> uniform{0.0, 1.0};
+	std::normal_distribution<flt_t> noise{0.0, 0.03};
+	const flt_t size = imageSize;
+
+	std::vector<Sample> samples;
+	samples.reserve(count);
+	std::vector<flt_t> image(imageSize * imageSize);
+	for(size_t i = 0; i != count; ++i) {
+		const size_t digit = label(engine);
+		const flt_t width = size * (0.25 + 0.15*uniform(engine));
+		const flt_t height = size * (0.5 + 0.15*uniform(engine));
+		const flt_t left = (size - width) / 2 + size * 0.1 * (uniform(engine) - 0.5);
+		const flt_t top = (size - height) / 2 + size * 0.1 * (uniform(engine) - 0.5);
+		const flt_t slant = 0.3 * (uniform(engine) - 0.5);
+		const flt_t halfThickness = size * (0.03 + 0.03*uniform(engine));
+
+		// transform the active segments into pixel coordinates once
+		std::vector<Segment> strokes;
+		for(size_t s = 0; s != 7; ++s) {
+			if (digitSegments[digit] & (1 << s)) {
+				auto toPixel = [&](const flt_t x, const flt_t y) {
+					return std::pair<flt_t, flt_t>{left + x*width + slant*((flt_t)0.5-y)*height, top + y*height};
+				};
+				auto [x0, y0] = toPixel(segments[s].x0, segments[s].y0);
+				auto [x1, y1] = toPixel(segments[s].x1, segments[s].y1);
+				strokes.push_back({x0, y0, x1, y1});
+			}
+		}
+
+		for(size_t y = 0; y != imageSize; ++y) {
+			for(size_t x = 0; x != imageSize; ++x) {
+				const flt_t px = x + 0.5, py = y + 0.5;
+				flt_t distance = size;
+				for(auto&& stroke : strokes) {
+					// distance from the pixel center to the stroke segment
+					const flt_t dx = stroke.x1 - stroke.x0, dy = stroke.y1 - stroke.y0;
+					const flt_t t = std::clamp(((px-stroke.x0)*dx + (py-stroke.y0)*dy) / (dx*dx + dy*dy), (flt_t)0.0, (flt_t)1.0);
+					distance = std::min(distance, std::hypot(px - stroke.x0 - t*dx, py - stroke.y0 - t*dy));
+				}
+				// antialiased stroke edge, one pixel wide
+				const flt_t value = std::clamp(halfThickness + (flt_t)0.5 - distance, (flt_t)0.0, (flt_t)1.0);
+				image[y*imageSize + x] = std::clamp(value + noise(engine), (flt_t)0.0, (flt_t)1.0);
+			}
+		}
+		samples.emplace_back(image, digit, 10);
+	}
+	return samples;
+}
+
+std::vector<Sample> autoencoderSet(const size_t count,
+		const size_t dimensions,
+		const unsigned int seed,
+		const size_t latentDimensions) {
+	std::mt19937 engine{seed};
+	std::normal_distribution<flt_t> normal{0.0, 1.0};
+
+	// every sample is sigmoid(projection * latent + offset)
+	std::vector<flt_t> projection(dimensions * latentDimensions), offset(dimensions);
+	const flt_t scale = 2.0 / std::sqrt(latentDimensions);
+	for(auto&& p : projection)
+		p = scale * normal(engine);
+	for(auto&& o : offset)
+		o = 0.5 * normal(engine);
+
+	std::vector<Sample> samples;
+	samples.reserve(count);
+	std::vector<flt_t> latent(latentDimensions), data(dimensions);
+	for(size_t i = 0; i != count; ++i) {
+		for(auto&& l : latent)
+			l = normal(engine);
+		for(size_t j = 0; j != dimensions; ++j) {
+			flt_t z = offset[j];
+			for(size_t k = 0; k != latentDimensions; ++k)
+				z += projection[j*latentDimensions + k] * latent[k];
+			data[j] = 1.0 / (1.0 + std::exp(-z));
+		}
+		samples.emplace_back(data);
+	}
+	return samples;
+}
+
+} /* namespace nn */
@@ -0,0 +1,59 @@
+#ifndef _NN_SYNTHETIC_HPP_
+#define _NN_SYNTHETIC_HPP_
+
+#include <vector>
+#include "utils.hpp"
+#include "Sample.hpp"
+
+namespace nn {
+
+/*
+	Deterministic synthetic datasets, so that benchmarks and experiments can be
+	reproduced on a fresh checkout without downloading MNIST or LFW.
+	The same seed always produces the same samples.
+*/
+
+/**
+ * @brief classification samples drawn from one gaussian blob per class
+ * @param count the number of samples to generate
+ * @param inputCount the dimensionality of the inputs
+ * @param classCount the number of classes (and of expected outputs)
+ * @param seed the seed of the generator
+ * @param spread standard deviation of every blob; the blob centers are drawn
+ *   with standard deviation 1, so higher values make the classes overlap more
+ */
+std::vector<Sample> gaussianBlobs(const size_t count,
+	const size_t inputCount,
+	const size_t classCount,
+	const unsigned int seed,
+	const flt_t spread = 0.5);
+
+/**
+ * @brief MNIST-like classification samples: seven-segment digits from 0 to 9,
+ *   rendered in grayscale with random size, position, slant, stroke thickness
+ *   and noise, with pixels in [0, 1] in row-major order
+ * @param count the number of samples to generate
+ * @param seed the seed of the generator
+ * @param imageSize the width and height of the images (28 like MNIST by default)
+ */
+std::vector<Sample> syntheticDigits(const size_t count,
+	const unsigned int seed,
+	const size_t imageSize = 28);
+
+/**
+ * @brief autoclassifier samples with values in (0, 1) lying on a random
+ *   nonlinear manifold of lower dimensionality, so that they can actually be
+ *   compressed by a bottleneck layer
+ * @param count the number of samples to generate
+ * @param dimensions the dimensionality of every sample
+ * @param seed the seed of the generator
+ * @param latentDimensions the dimensionality of the manifold
+ */
+std::vector<Sample> autoencoderSet(const size_t count,
+	const size_t dimensions,
+	const unsigned int seed,
+	const size_t latentDimensions = 8);
+
+} // namespace nn
+
+#endif // _NN_SYNTHETIC_HPP_
@@ -0,0 +1,387 @@
+#include "Telemetry.hpp"
+
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace nn {
+
+namespace {
+	// overload pattern for std::visit
+	template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
+	template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
+
+	std::string escapeJson(const std::string& string) {
+		static const char hexDigits[] = "0123456789abcdef";
+		std::string result;
+		for(auto&& c : string) {
+			const unsigned char code = c;
+			if (c == '"' || c == '\\') {
+				result += '\\';
+				result += c;
+			} else if (code < 0x20) {
+				result += "\\u00";
+				result += hexDigits[code >> 4];
+				result += hexDigits[code & 0xf];
+			} else {
+				result += c;
+			}
+		}
+		return result;
+	}
+
+	// JSON has no nan nor infinity, which a diverging training reports
+	template<class T>
+	struct JsonNumber {
+		T value;
+	};
+
+	template<class T>
+	JsonNumber<T> jsonNumber(const T value) {
+		return {value};
+	}
+
+	template<class T>
+	std::ostream& operator<<(std::ostream& out, const JsonNumber<T>& number) {
+		if (!std::isfinite(number.value))
+			return out << "null";
+		return out << number.value;
+	}
+
+	std::string escapeCsv(const std::string& string) {
+		std::string result = "\"";
+		for(auto&& c : string) {
+			if (c == '"')
+				result += '"';
+			result += c;
+		}
+		return result + "\"";
+	}
+
+	// the columns of the CSV format before the per phase columns
+	enum CsvColumn : size_t {
+		eventColumn, epochColumn, epochsColumn, miniBatchColumn, samplesColumn,
+		secondsColumn, samplesPerSecondColumn, gflopsColumn, activationBytesColumn,
+		trainingCostColumn, trainingCorrectColumn, trainingClassifiedColumn,
+		correctColumn, totalColumn, populationColumn, accuracyLowColumn, accuracyHighColumn, costColumn,
+		filenameColumn,
+		phaseColumns,
+	};
+	constexpr const char* csvColumnNames[phaseColumns] = {
+		"event", "epoch", "epochs", "mini_batch", "samples",
+		"seconds", "samples_per_s", "gflops", "activation_bytes",
+		"training_cost", "training_correct", "training_classified",
+		"correct", "total", "population", "accuracy_low", "accuracy_high", "cost",
+		"filename",
+	};
+	constexpr size_t csvColumnCount = phaseColumns + Profiler::phaseCount * (1 + PerfCounters::counterCount);
+
+	constexpr size_t phaseColumn(const size_t phase, const size_t counter = PerfCounters::counterCount) {
+		// the time of a phase comes first, followed by its counters
+		return phaseColumns + phase * (1 + PerfCounters::counterCount) + (counter == PerfCounters::counterCount ? 0 : 1 + counter);
+	}
+
+	/**
+	 * @brief one CSV row, whose cells are empty unless they are set
+	 */
+	class CsvRow {
+	public:
+		CsvRow() : m_cells(csvColumnCount) {}
+
+		template<class T>
+		CsvRow& set(const size_t column, const T& value) {
+			std::ostringstream cell;
+			cell << value;
+			m_cells[column] = cell.str();
+			return *this;
+		}
+
+		void write(std::ostream& out) const {
+			for(size_t column = 0; column != csvColumnCount; ++column)
+				out << (column == 0 ? "" : ",") << m_cells[column];
+			out << "\n";
+		}
+
+	private:
+		std::vector<std::string> m_cells;
+	};
+}
+
+
+StreamPrinter::StreamPrinter(std::ostream& out) : m_out{out} {}
+
+void StreamPrinter::onEvaluation(const EvaluationEvent& event) {
+	if (event.epoch == 0)
+		m_out << "Before " << std::setw(std::log10(event.epochs+1)) << "";
+	else
+		m_out << "Epoch " << std::setw(std::log10(event.epochs+1) + 1) << event.epoch;
+	if (event.miniBatch != 0)
+		m_out << "  -  Mini batch " << event.miniBatch;
+	m_out << "  -  Accuracy: " << std::setw(std::log10(event.total) + 1) << event.correct << " / " << event.total;
+	if (event.subsampled) {
+		const auto flags = m_out.flags();
+		const auto precision = m_out.precision();
+		m_out << std::fixed << std::setprecision(2) << " (" << 100 * event.accuracyLow << "% - " <<
+			100 * event.accuracyHigh << "% of " << event.population << ")";
+		m_out.flags(flags);
+		m_out.precision(precision);
+	}
+	if (event.hasCost)
+		m_out << "  -  Cost: " << event.cost;
+	m_out << "\n";
+}
+
+void StreamPrinter::onCheckpoint(const CheckpointEvent& event) {
+	m_out << "Checkpoint written to " << event.filename << "\n";
+}
+
+void StreamPrinter::onEpochEnd(const EpochEndEvent& event) {
+	m_out << "        Training";
+	if (event.trainingClassified != 0)
+		m_out << "  -  Accuracy: " << event.trainingCorrect << " / " << event.trainingClassified;
+	m_out << "  -  Cost: " << event.trainingCost << "\n";
+	if (!event.profiled)
+		return;
+
+	const auto flags = m_out.flags();
+	const auto precision = m_out.precision();
+	m_out << std::fixed << std::setprecision(3) <<
+		"        Samples/s: " << std::setprecision(0) << event.samplesPerSecond <<
+		"  -  GFLOP/s: " << std::setprecision(3) << event.gflops <<
+		"  -  Activations (KiB): " << std::setprecision(0) << event.activationBytes / 1024.0 <<
+		"  -  Time (s):";
+	double trainingSeconds = 0;
+	for(size_t phase = 0; phase != Profiler::phaseCount; ++phase) {
+		m_out << " " << Profiler::phaseNames[phase] << "=" << event.phaseSeconds[phase];
+		if (phase <= Profiler::update)
+			trainingSeconds += event.phaseSeconds[phase];
+	}
+	// e.g. waiting for a SampleSource to produce mini batches
+	m_out << " other=" << event.seconds - trainingSeconds << "\n";
+
+	if (event.counted) {
+		for(size_t phase = 0; phase != Profiler::phaseCount; ++phase) {
+			if (event.phaseSeconds[phase] == 0)
+				continue;
+
+			const PerfCounters::Values& counts = event.phaseCounts[phase];
+			m_out << "        " << std::setw(10) << std::left << Profiler::phaseNames[phase] << std::right;
+			for(size_t c = 0; c != PerfCounters::counterCount; ++c) {
+				m_out << " " << PerfCounters::counterNames[c] << "=";
+				if (event.countersAvailable[c])
+					m_out << counts[c];
+				else
+					m_out << "n/a";
+			}
+			if (counts[PerfCounters::cycles] != 0 && event.countersAvailable[PerfCounters::instructions])
+				m_out << std::setprecision(2) << " IPC=" << (double)counts[PerfCounters::instructions] / counts[PerfCounters::cycles];
+			m_out << "\n";
+		}
+	}
+	m_out.flags(flags);
+	m_out.precision(precision);
+}
+
+
+AsyncSink::AsyncSink(std::ostream& out, const Format format, const bool miniBatchEvents) :
+		m_out{out}, m_format{format}, m_miniBatchEvents{miniBatchEvents},
+		m_queue{}, m_writing{false}, m_stopping{false} {
+	if (m_format == Format::csv) {
+		for(size_t column = 0; column != phaseColumns; ++column)
+			m_out << (column == 0 ? "" : ",") << csvColumnNames[column];
+		for(size_t phase = 0; phase != Profiler::phaseCount; ++phase) {
+			m_out << "," << Profiler::phaseNames[phase] << "_s";
+			for(size_t c = 0; c != PerfCounters::counterCount; ++c)
+				m_out << "," << Profiler::phaseNames[phase] << "_" << PerfCounters::counterNames[c];
+		}
+		m_out << "\n";
+	}
+	m_writer = std::thread{&AsyncSink::write, this};
+}
+
+AsyncSink::~AsyncSink() {
+	{
+		std::lock_guard lock{m_mutex};
+		m_stopping = true;
+	}
+	m_eventAvailable.notify_one();
+	m_writer.join();
+}
+
+void AsyncSink::onEpochStart(const EpochStartEvent& event) {
+	push(event);
+}
+
+void AsyncSink::onMiniBatch(const MiniBatchEvent& event) {
+	if (m_miniBatchEvents)
+		push(event);
+}
+
+void AsyncSink::onEpochEnd(const EpochEndEvent& event) {
+	push(event);
+}
+
+void AsyncSink::onEvaluation(const EvaluationEvent& event) {
+	push(event);
+}
+
+void AsyncSink::onCheckpoint(const CheckpointEvent& event) {
+	push(event);
+}
+
+void AsyncSink::flush() {
+	std::unique_lock lock{m_mutex};
+	m_drained.wait(lock, [this]{ return m_queue.empty() && !m_writing; });
+}
+
+void AsyncSink::push(Event&& event) {
+	{
+		std::lock_guard lock{m_mutex};
+		m_queue.push_back(std::move(event));
+	}
+	m_eventAvailable.notify_one();
+}
+
+void AsyncSink::write() {
+	std::unique_lock lock{m_mutex};
+	while(1) {
+		m_eventAvailable.wait(lock, [this]{ return m_stopping || !m_queue.empty(); });
+		if (m_queue.empty())
+			return; // stopping and everything was written
+
+		std::deque<Event> events;
+		std::swap(events, m_queue);
+		m_writing = true;
+		lock.unlock();
+
+		for(auto&& event : events) {
+			if (m_format == Format::jsonLines)
+				writeJson(event);
+			else
+				writeCsv(event);
+		}
+		m_out.flush();
+
+		lock.lock();
+		m_writing = false;
+		m_drained.notify_all();
+	}
+}
+
+void AsyncSink::writeJson(const Event& event) {
+	std::visit(overloaded{
+		[this](const EpochStartEvent& e) {
+			m_out << "{\"event\":\"epoch_start\",\"epoch\":" << e.epoch << ",\"epochs\":" << e.epochs << "}\n";
+		},
+		[this](const MiniBatchEvent& e) {
+			m_out << "{\"event\":\"mini_batch\",\"epoch\":" << e.epoch << ",\"mini_batch\":" << e.miniBatch
+				<< ",\"samples\":" << e.samples << "}\n";
+		},
+		[this](const EpochEndEvent& e) {
+			m_out << "{\"event\":\"epoch_end\",\"epoch\":" << e.epoch << ",\"epochs\":" << e.epochs
+				<< ",\"samples\":" << e.samples << ",\"seconds\":" << jsonNumber(e.seconds)
+				<< ",\"samples_per_s\":" << jsonNumber(e.samplesPerSecond) << ",\"gflops\":" << jsonNumber(e.gflops)
+				<< ",\"activation_bytes\":" << e.activationBytes
+				<< ",\"training_cost\":" << jsonNumber(e.trainingCost) << ",\"training_correct\":" << e.trainingCorrect
+				<< ",\"training_classified\":" << e.trainingClassified;
+			if (e.profiled) {
+				m_out << ",\"phases\":{";
+				for(size_t phase = 0; phase != Profiler::phaseCount; ++phase) {
+					m_out << (phase == 0 ? "" : ",") << "\"" << Profiler::phaseNames[phase]
+						<< "\":{\"seconds\":" << jsonNumber(e.phaseSeconds[phase]);
+					for(size_t c = 0; e.counted && c != PerfCounters::counterCount; ++c) {
+						if (e.countersAvailable[c])
+							m_out << ",\"" << PerfCounters::counterNames[c] << "\":" << e.phaseCounts[phase][c];
+					}
+					m_out << "}";
+				}
+				m_out << "}";
+			}
+			m_out << "}\n";
+		},
+		[this](const EvaluationEvent& e) {
+			m_out << "{\"event\":\"evaluation\",\"epoch\":" << e.epoch << ",\"epochs\":" << e.epochs
+				<< ",\"mini_batch\":" << e.miniBatch << ",\"correct\":" << e.correct << ",\"total\":" << e.total
+				<< ",\"population\":" << e.population;
+			if (e.subsampled)
+				m_out << ",\"accuracy_low\":" << jsonNumber(e.accuracyLow) << ",\"accuracy_high\":" << jsonNumber(e.accuracyHigh);
+			if (e.hasCost)
+				m_out << ",\"cost\":" << jsonNumber(e.cost);
+			m_out << "}\n";
+		},
+		[this](const CheckpointEvent& e) {
+			m_out << "{\"event\":\"checkpoint\",\"epoch\":" << e.epoch
+				<< ",\"filename\":\"" << escapeJson(e.filename) << "\"}\n";
+		},
+	}, event);
+}
+
+void AsyncSink::writeCsv(const Event& event) {
+	CsvRow row;
+	std::visit(overloaded{
+		[&](const EpochStartEvent& e) {
+			row.set(eventColumn, "epoch_start").set(epochColumn, e.epoch).set(epochsColumn, e.epochs);
+		},
+		[&](const MiniBatchEvent& e) {
+			row.set(eventColumn, "mini_batch").set(epochColumn, e.epoch)
+				.set(miniBatchColumn, e.miniBatch).set(samplesColumn, e.samples);
+		},
+		[&](const EpochEndEvent& e) {
+			row.set(eventColumn, "epoch_end").set(epochColumn, e.epoch).set(epochsColumn, e.epochs)
+				.set(samplesColumn, e.samples).set(secondsColumn, e.seconds)
+				.set(samplesPerSecondColumn, e.samplesPerSecond).set(gflopsColumn, e.gflops)
+				.set(activationBytesColumn, e.activationBytes)
+				.set(trainingCostColumn, e.trainingCost).set(trainingCorrectColumn, e.trainingCorrect)
+				.set(trainingClassifiedColumn, e.trainingClassified);
+			for(size_t phase = 0; phase != Profiler::phaseCount; ++phase) {
+				if (e.profiled)
+					row.set(phaseColumn(phase), e.phaseSeconds[phase]);
+				for(size_t c = 0; c != PerfCounters::counterCount; ++c) {
+					if (e.counted && e.countersAvailable[c])
+						row.set(phaseColumn(phase, c), e.phaseCounts[phase][c]);
+				}
+			}
+		},
+		[&](const EvaluationEvent& e) {
+			row.set(eventColumn, "evaluation").set(epochColumn, e.epoch).set(epochsColumn, e.epochs)
+				.set(miniBatchColumn, e.miniBatch).set(correctColumn, e.correct).set(totalColumn, e.total)
+				.set(populationColumn, e.population);
+			if (e.subsampled)
+				row.set(accuracyLowColumn, e.accuracyLow).set(accuracyHighColumn, e.accuracyHigh);
+			if (e.hasCost)
+				row.set(costColumn, e.cost);
+		},
+		[&](const CheckpointEvent& e) {
+			row.set(eventColumn, "checkpoint").set(epochColumn, e.epoch).set(filenameColumn, escapeCsv(e.filename));
+		},
+	}, event);
+	row.write(m_out);
+}
+
+
+void ObserverList::onEpochStart(const EpochStartEvent& event) {
+	for(auto&& observer : m_observers)
+		observer->onEpochStart(event);
+}
+
+void ObserverList::onMiniBatch(const MiniBatchEvent& event) {
+	for(auto&& observer : m_observers)
+		observer->onMiniBatch(event);
+}
+
+void ObserverList::onEpochEnd(const EpochEndEvent& event) {
+	for(auto&& observer : m_observers)
+		observer->onEpochEnd(event);
+}
+
+void ObserverList::onEvaluation(const EvaluationEvent& event) {
+	for(auto&& observer : m_observers)
+		observer->onEvaluation(event);
+}
+
+void ObserverList::onCheckpoint(const CheckpointEvent& event) {
+	for(auto&& observer : m_observers)
+		observer->onCheckpoint(event);
+}
+
+} /* namespace nn */
@@ -0,0 +1,185 @@
+#ifndef _NN_TELEMETRY_HPP_
+#define _NN_TELEMETRY_HPP_
+
+#include <array>
+#include <string>
+#include <ostream>
+#include <variant>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "utils.hpp"
+#include "Profiler.hpp"
+#include "PerfCounters.hpp"
+
+namespace nn {
+
+struct EpochStartEvent {
+	size_t epoch, epochs; // epoch counts from 1
+};
+
+struct MiniBatchEvent {
+	size_t epoch;
+	size_t miniBatch; // index in the epoch, from 0
+	size_t samples; // in this mini batch
+};
+
+// sent after the evaluation that follows the epoch, whose time is also profiled
+struct EpochEndEvent {
+	size_t epoch, epochs;
+	size_t samples; // trained on during the epoch
+	double seconds; // wall-clock time of the training epoch, without evaluation
+	double samplesPerSecond;
+	double gflops; // achieved GFLOP/s, computed from the topology
+	size_t activationBytes; // kept for the backward pass, @see Network::activationBytes
+
+	// measured during the forward passes of training, while the weights were
+	// still changing, so they are only an approximation of the final ones
+	double trainingCost; // average per sample, without regularization
+	size_t trainingCorrect; // samples whose largest output was the expected one
+	size_t trainingClassified; // samples with more than one expected output, 0 for autoclassifiers
+
+	bool profiled; // whether phaseSeconds is filled, @see Network::setProfiling
+	std::array<double, Profiler::phaseCount> phaseSeconds;
+	bool counted; // whether phaseCounts is filled, @see Network::setPerfCounters
+	std::array<bool, PerfCounters::counterCount> countersAvailable;
+	std::array<PerfCounters::Values, Profiler::phaseCount> phaseCounts;
+};
+
+struct EvaluationEvent {
+	size_t epoch, epochs; // epoch is 0 for the evaluation before training
+	size_t miniBatch; // mini batches done in the epoch, or 0 at the end of the epoch
+	size_t correct, total; // total is the number of evaluated samples
+	size_t population; // the number of all test samples
+	bool subsampled; // whether only a random subset of the test samples was evaluated
+	double accuracyLow, accuracyHigh; // confidence interval of the accuracy on all test samples
+	bool hasCost;
+	flt_t cost; // on the evaluated samples, only valid if hasCost
+};
+
+struct CheckpointEvent {
+	size_t epoch;
+	std::string filename;
+};
+
+/**
+ * @brief receives structured events during training. All methods do nothing
+ *   by default, so implementations override only the events they need.
+ *   Methods are called on the training thread, so they should return quickly.
+ */
+class TrainingObserver {
+public:
+	virtual ~TrainingObserver() = default;
+
+	virtual void onEpochStart(const EpochStartEvent&) {}
+	virtual void onMiniBatch(const MiniBatchEvent&) {}
+	virtual void onEpochEnd(const EpochEndEvent&) {}
+	virtual void onEvaluation(const EvaluationEvent&) {}
+	virtual void onCheckpoint(const CheckpointEvent&) {}
+};
+
+/**
+ * @brief prints human readable network statistics after every epoch, and the
+ *   profiling statistics too if they are available
+ */
+class StreamPrinter : public TrainingObserver {
+public:
+	StreamPrinter(std::ostream& out);
+
+	void onEpochEnd(const EpochEndEvent& event) override;
+	void onEvaluation(const EvaluationEvent& event) override;
+	void onCheckpoint(const CheckpointEvent& event) override;
+
+private:
+	std::ostream& m_out;
+};
+
+/**
+ * @brief writes every event as one machine readable record on an output stream.
+ *   Events are only copied into a queue on the training thread, while
+ *   formatting and writing happen on a background thread.
+ *   Pending records are all written before the sink is destroyed.
+ */
+class AsyncSink : public TrainingObserver {
+public:
+	enum class Format {
+		jsonLines, // one JSON object per line, with an "event" field
+		csv, // one row per event with a fixed set of columns, after a header
+	};
+
+	/**
+	 * @param out where to write records; it must outlive the sink
+	 * @param format how to format records
+	 * @param miniBatchEvents whether to record also every mini batch
+	 */
+	AsyncSink(std::ostream& out, const Format format, const bool miniBatchEvents = false);
+	~AsyncSink() override;
+
+	AsyncSink(const AsyncSink&) = delete;
+	AsyncSink& operator=(const AsyncSink&) = delete;
+
+	void onEpochStart(const EpochStartEvent& event) override;
+	void onMiniBatch(const MiniBatchEvent& event) override;
+	void onEpochEnd(const EpochEndEvent& event) override;
+	void onEvaluation(const EvaluationEvent& event) override;
+	void onCheckpoint(const CheckpointEvent& event) override;
+
+	/**
+	 * @brief blocks until all events received so far have been written and flushed
+	 */
+	void flush();
+
+private:
+	using Event = std::variant<EpochStartEvent, MiniBatchEvent, EpochEndEvent, EvaluationEvent, CheckpointEvent>;
+
+	std::ostream& m_out;
+	const Format m_format;
+	const bool m_miniBatchEvents;
+
+	std::deque<Event> m_queue;
+	bool m_writing, m_stopping;
+	std::mutex m_mutex;
+	std::condition_variable m_eventAvailable, m_drained;
+	std::thread m_writer;
+
+	void push(Event&& event);
+	void write();
+	void writeJson(const Event& event);
+	void writeCsv(const Event& event);
+};
+
+class JsonLinesSink : public AsyncSink {
+public:
+	JsonLinesSink(std::ostream& out, const bool miniBatchEvents = false)
+		: AsyncSink{out, Format::jsonLines, miniBatchEvents} {}
+};
+
+class CsvSink : public AsyncSink {
+public:
+	CsvSink(std::ostream& out, const bool miniBatchEvents = false)
+		: AsyncSink{out, Format::csv, miniBatchEvents} {}
+};
+
+/**
+ * @brief forwards every event to multiple observers, e.g. to print to the
+ *   console and to write to a JSON lines file at the same time
+ */
+class ObserverList : public TrainingObserver {
+public:
+	ObserverList(const std::initializer_list<TrainingObserver*>& observers) : m_observers{observers} {}
+
+	void onEpochStart(const EpochStartEvent& event) override;
+	void onMiniBatch(const MiniBatchEvent& event) override;
+	void onEpochEnd(const EpochEndEvent& event) override;
+	void onEvaluation(const EvaluationEvent& event) override;
+	void onCheckpoint(const CheckpointEvent& event) override;
+
+private:
+	std::vector<TrainingObserver*> m_observers;
+};
+
+} // namespace nn
+
+#endif // _NN_TELEMETRY_HPP_
@@ -0,0 +1,80 @@
+#include "ThreadPool.hpp"
+
+namespace nn {
+
+ThreadPool::ThreadPool() :
+		m_threads{}, m_task{nullptr}, m_generation{0}, m_workers{0}, m_running{0},
+		m_error{}, m_stopping{false} {}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard lock{m_mutex};
+		m_stopping = true;
+	}
+	m_workAvailable.notify_all();
+	for(auto&& thread : m_threads)
+		thread.join();
+}
+
+void ThreadPool::run(const size_t workers, const std::function<void(const size_t)>& task) {
+	if (workers <= 1) {
+		task(0);
+		return;
+	}
+
+	{
+		std::lock_guard lock{m_mutex};
+		// the new threads wait for the next run, which is this one
+		while(m_threads.size() + 1 < workers)
+			m_threads.emplace_back(&ThreadPool::work, this, m_threads.size() + 1, m_generation);
+		m_task = &task;
+		++m_generation;
+		m_workers = workers;
+		m_running = workers - 1;
+		m_error = nullptr;
+	}
+	m_workAvailable.notify_all();
+
+	// the other workers use the task until they return, even if this one throws
+	std::exception_ptr error;
+	try {
+		task(0);
+	} catch(...) {
+		error = std::current_exception();
+	}
+	std::unique_lock lock{m_mutex};
+	m_done.wait(lock, [this]{ return m_running == 0; });
+	if (!error)
+		error = m_error;
+	lock.unlock();
+	if (error)
+		std::rethrow_exception(error);
+}
+
+void ThreadPool::work(const size_t worker, size_t generation) {
+	std::unique_lock lock{m_mutex};
+	while(1) {
+		m_workAvailable.wait(lock, [&]{ return m_stopping || m_generation != generation; });
+		if (m_stopping)
+			return;
+		generation = m_generation;
+		if (worker >= m_workers)
+			continue;
+		lock.unlock();
+
+		std::exception_ptr error;
+		try {
+			(*m_task)(worker);
+		} catch(...) {
+			error = std::current_exception();
+		}
+
+		lock.lock();
+		if (error && !m_error)
+			m_error = error;
+		if (--m_running == 0)
+			m_done.notify_one();
+	}
+}
+
+} /* namespace nn */
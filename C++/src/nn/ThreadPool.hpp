@@ -0,0 +1,55 @@
+#ifndef _NN_THREADPOOL_HPP_
+#define _NN_THREADPOOL_HPP_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+namespace nn {
+
+/**
+ * @brief threads that wait between tasks instead of being started for every
+ *   one of them, for work too short to afford it, e.g. Network::calculateBatch
+ */
+class ThreadPool {
+public:
+	ThreadPool();
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/**
+	 * @brief calls task(worker) for every worker in [0, workers) at once, and
+	 *   returns when all of them returned. The calling thread is worker 0, the
+	 *   others are threads of the pool, started the first time they are needed.
+	 *   Not reentrant: run must not be called again before it returns.
+	 * @throw the exception of a worker, once all of them returned
+	 */
+	void run(const size_t workers, const std::function<void(const size_t)>& task);
+
+private:
+	/**
+	 * @brief runs the tasks of thread `worker` of the pool
+	 * @param generation the last run the thread saw
+	 */
+	void work(const size_t worker, size_t generation);
+
+	std::mutex m_mutex;
+	std::condition_variable m_workAvailable, m_done;
+	std::vector<std::thread> m_threads; // m_threads[i] is worker i+1
+
+	const std::function<void(const size_t)>* m_task;
+	size_t m_generation; // incremented by every run
+	size_t m_workers; // of the current run
+	size_t m_running; // threads of the pool still in the current task
+	std::exception_ptr m_error; // the first one thrown by a thread of the pool
+	bool m_stopping;
+};
+
+} // namespace nn
+
+#endif // _NN_THREADPOOL_HPP_
@@ -4,10 +4,17 @@
 
 namespace nn {
 
+	std::mt19937& randomEngine() {
+		static std::mt19937 engine{std::random_device{}()};
+		return engine;
+	}
+
 	flt_t random(const flt_t standardDeviation) {
-		static std::random_device rd;
-		static std::mt19937 engine{rd()};
-		return std::normal_distribution{(flt_t)0.0, standardDeviation}(engine);
+		return std::normal_distribution{(flt_t)0.0, standardDeviation}(randomEngine());
+	}
+
+	void setRandomSeed(const unsigned int seed) {
+		randomEngine().seed(seed);
 	}
 
 }
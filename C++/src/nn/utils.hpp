@@ -1,12 +1,28 @@
 #ifndef _NN_UTILS_HPP_
 #define _NN_UTILS_HPP_
 
+#include <cstddef>
+#include <random>
+
 namespace nn {
 
 	using flt_t = float;
 
 	flt_t random(const flt_t standardDeviation);
 
+	/**
+	 * @brief makes the parameters of newly constructed networks and the order
+	 *   of the training samples reproducible
+	 * @param seed seed of the engine used by random() and randomEngine()
+	 */
+	void setRandomSeed(const unsigned int seed);
+
+	/**
+	 * @return the engine of the library, e.g. to shuffle the training samples
+	 * @see setRandomSeed
+	 */
+	std::mt19937& randomEngine();
+
 }
 
 #endif /* _NN_UTILS_HPP_ */
@@ -0,0 +1,147 @@
+#include "nn/Network.hpp"
+#include "nn/Convolution.hpp"
+#include "nn/ActivationFunction.hpp"
+#include "nn/CostFunction.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+	Checks that the allocation-free overloads of calculate and calculateView
+	never allocate once the network has run a first sample, whatever the
+	density of the inputs, by counting the calls to the global operator new.
+	Returns 1 if any of them allocated.
+*/
+
+using nn::flt_t;
+using nn::Sample;
+
+namespace {
+	size_t allocations = 0;
+}
+
+void* operator new(const size_t bytes) {
+	++allocations;
+	if (void* pointer = std::malloc(bytes > 0 ? bytes : 1))
+		return pointer;
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+	std::free(pointer);
+}
+
+namespace {
+
+constexpr size_t imageSize = 16;
+constexpr size_t inputCount = imageSize * imageSize;
+
+/**
+ * @brief inputs of every density from all 0 to all nonzero and back, so that
+ *   the network switches between its sparse and dense input paths
+ */
+std::vector<std::vector<flt_t>> inputsOfChangingDensity() {
+	std::mt19937 engine{42};
+	std::uniform_real_distribution<flt_t> value{0.1, 1};
+	std::vector<std::vector<flt_t>> inputs;
+	for(const double density : {0.0, 0.02, 0.3, 1.0, 0.05, 0.6, 0.0, 0.01, 1.0}) {
+		std::bernoulli_distribution nonzero{density};
+		inputs.emplace_back(inputCount);
+		for(auto&& input : inputs.back()) {
+			if (nonzero(engine))
+				input = value(engine);
+		}
+	}
+	return inputs;
+}
+
+Sample sparseSample(const std::vector<flt_t>& inputs) {
+	std::vector<uint32_t> nonzeroInputs;
+	std::vector<flt_t> nonzeroValues;
+	for(size_t i = 0; i != inputs.size(); ++i) {
+		if (inputs[i] != 0) {
+			nonzeroInputs.push_back(i);
+			nonzeroValues.push_back(inputs[i]);
+		}
+	}
+	return Sample{inputs.size(), std::move(nonzeroInputs), std::move(nonzeroValues), 0};
+}
+
+/**
+ * @return `true` if no overload allocated after the first sample
+ */
+bool check(const std::string& name, nn::Network& network) {
+	const std::vector<std::vector<flt_t>> inputs = inputsOfChangingDensity();
+	std::vector<Sample> samples;
+	for(auto&& in : inputs) {
+		samples.emplace_back(in, 0, network.outputCount());
+		samples.emplace_back(in, 0, network.outputCount());
+		samples.back().computeNonzeroInputs();
+		samples.push_back(sparseSample(in));
+	}
+	std::vector<flt_t> outputs(network.outputCount());
+
+	// a single warm-up sample, the sparsest one
+	network.calculate(inputs[0], outputs.data());
+
+	bool passed = true;
+	auto expectNoAllocation = [&](const char* overload, auto&& calculate) {
+		const size_t before = allocations;
+		calculate();
+		if (allocations != before) {
+			std::cerr << name << ": " << overload << " made "
+				<< allocations - before << " allocations" << std::endl;
+			passed = false;
+		}
+	};
+	for(size_t i = 0; i != inputs.size(); ++i) {
+		expectNoAllocation("calculate(inputs, outputs)", [&] {
+			network.calculate(inputs[i], outputs.data());
+		});
+		expectNoAllocation("calculateView(inputs)", [&] {
+			network.calculateView(inputs[i]);
+		});
+		for(size_t s = 3 * i; s != 3 * i + 3; ++s) {
+			expectNoAllocation("calculate(sample, outputs)", [&] {
+				network.calculate(samples[s], outputs.data());
+			});
+			expectNoAllocation("calculateView(sample)", [&] {
+				network.calculateView(samples[s]);
+			});
+		}
+	}
+	std::cout << name << (passed ? ": passed" : ": FAILED") << std::endl;
+	return passed;
+}
+
+} // namespace
+
+int main() {
+	bool passed = true;
+
+	nn::Network dense{{inputCount, 32, 10}, {&nn::rectifiedLinear, &nn::softmax},
+		nn::categoricalCrossEntropyCost};
+	passed &= check("dense", dense);
+
+	std::stringstream stream;
+	stream << dense;
+	nn::Network loaded{nn::sigmoid, nn::categoricalCrossEntropyCost};
+	stream >> loaded;
+	passed &= check("loaded", loaded);
+
+	const nn::Conv2D encoder{{imageSize, imageSize, 1}, 4, 4, 2, 1};
+	const nn::ConvTranspose2D decoder{encoder.outputShape(), 1, 4, 2, 1};
+	nn::Network conv{{inputCount, encoder.outputShape().size(), inputCount},
+		{&nn::rectifiedLinear, &nn::sigmoid}, {&encoder, &decoder}, nn::crossEntropyCost};
+	passed &= check("conv", conv);
+
+	return passed ? 0 : 1;
+}